@@ -0,0 +1,351 @@
+/*
+  ==============================================================================
+
+    Headless batch renderer: applies one semantic chain to many audio files.
+
+    Usage:
+      SemanticEQBatchRender (--prompt <text> | --chain <file.json>)
+                            --output <directory> [--threads <n>]
+                            [--block-size <n>] [--segment-seconds <s>] [--local]
+                            [--verify] <files or directories>...
+
+    --chain takes a chain saved in the parameter server's JSON schema.
+    Renders are written as WAV under --output, keeping the layout of any
+    directory that was scanned. Two inputs that would render to the same
+    file, or a render that would overwrite an input, stop the batch.
+    --local answers --prompt from the built-in presets instead of the server.
+    --segment-seconds renders files one at a time, each split into segments
+    of that length across the worker threads; use it for a few long files.
+    --verify writes nothing: it renders the start of each file both serially
+    and in segments, and prints the largest difference between the two.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/ChainOptimiser.h"
+#include "../../Source/OfflineRenderer.h"
+#include "../../Source/ParameterServerClient.h"
+#include "../../Source/PresetIndex.h"
+
+namespace
+{
+    struct Settings
+    {
+        juce::String prompt;
+        juce::File chainFile, outputDirectory;
+        int numThreads = juce::SystemStats::getNumCpus();
+        int blockSize = OfflineRenderer::defaultBlockSize;
+        double segmentSeconds = 0.0;
+        bool localOnly = false;
+        bool verify = false;
+        juce::StringArray inputs;
+    };
+
+    bool parseArguments(const juce::StringArray &args, Settings &settings)
+    {
+        for (int i = 0; i < args.size(); ++i)
+        {
+            auto &arg = args[i];
+            auto hasValue = i + 1 < args.size();
+
+            if (arg == "--prompt" && hasValue)
+                settings.prompt = args[++i];
+            else if (arg == "--chain" && hasValue)
+                settings.chainFile = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+            else if (arg == "--output" && hasValue)
+                settings.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+            else if (arg == "--threads" && hasValue)
+                settings.numThreads = juce::jmax(1, args[++i].getIntValue());
+            else if (arg == "--block-size" && hasValue)
+                settings.blockSize = juce::jmax(1, args[++i].getIntValue());
+            else if (arg == "--segment-seconds" && hasValue)
+                settings.segmentSeconds = juce::jmax(0.0, args[++i].getDoubleValue());
+            else if (arg == "--local")
+                settings.localOnly = true;
+            else if (arg == "--verify")
+                settings.verify = true;
+            else if (arg.startsWith("--"))
+                return false;
+            else
+                settings.inputs.add(arg);
+        }
+
+        return (settings.prompt.isNotEmpty() != (settings.chainFile != juce::File()))
+            && (settings.outputDirectory != juce::File() || settings.verify)
+            && !settings.inputs.isEmpty();
+    }
+
+    bool resolveChain(const Settings &settings, ChainDescription &chain)
+    {
+        if (settings.chainFile != juce::File())
+            return ChainDescription::fromJSON(juce::JSON::parse(settings.chainFile), chain);
+
+        if (!settings.localOnly)
+        {
+            auto *body = new juce::DynamicObject();
+            body->setProperty("query", settings.prompt);
+
+            ParameterServerClient client(ParameterServerClient::Options{});
+            juce::String response;
+            if (client.post(juce::JSON::toString(juce::var(body), true), response)
+                && ChainDescription::fromJSON(juce::JSON::parse(response), chain))
+            {
+                chain.prompt = settings.prompt;
+                return true;
+            }
+
+            std::cerr << "Parameter server unavailable, using the built-in presets" << std::endl;
+        }
+
+        juce::SharedResourcePointer<PresetIndex> presetIndex;
+        return presetIndex->findNearest(settings.prompt, chain);
+    }
+
+    /**
+        Fills outputPaths with where each file's render goes, relative to the
+        output directory: files found in a directory keep their path below
+        it, files named directly go at the top.
+     */
+    juce::Array<juce::File> collectInputFiles(const juce::StringArray &inputs, juce::StringArray &outputPaths)
+    {
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+        auto wildcard = formatManager.getWildcardForAllFormats();
+
+        juce::Array<juce::File> files;
+        for (auto &input : inputs)
+        {
+            auto file = juce::File::getCurrentWorkingDirectory().getChildFile(input);
+
+            if (file.isDirectory())
+            {
+                for (auto &child : file.findChildFiles(juce::File::findFiles, true, wildcard))
+                {
+                    files.add(child);
+                    outputPaths.add(child.withFileExtension("wav").getRelativePathFrom(file));
+                }
+            }
+            else if (file.existsAsFile())
+            {
+                files.add(file);
+                outputPaths.add(file.withFileExtension("wav").getFileName());
+            }
+            else
+            {
+                std::cerr << "Skipping " << input << ": not found" << std::endl;
+            }
+        }
+
+        return files;
+    }
+
+    /**
+        Parallel jobs writing the same file would lose one render or corrupt
+        both, and a job writing over an input would destroy it while it may
+        still be read, so either stops the whole batch before anything runs.
+     */
+    bool resolveOutputFiles(const juce::Array<juce::File> &files, const juce::StringArray &outputPaths,
+                            const juce::File &outputDirectory, juce::Array<juce::File> &outputFiles)
+    {
+        juce::StringArray inputPaths, usedPaths;
+        for (auto &file : files)
+            inputPaths.add(file.getFullPathName());
+
+        auto succeeded = true;
+
+        for (int i = 0; i < files.size(); ++i)
+        {
+            auto output = outputDirectory.getChildFile(outputPaths[i]);
+            auto path = output.getFullPathName();
+
+            // Compared ignoring case, as the macOS and Windows file systems do
+            if (inputPaths.contains(path, true))
+            {
+                std::cerr << "Refusing to render " << files[i].getFullPathName() << ": " << path << " is an input" << std::endl;
+                succeeded = false;
+            }
+            else if (usedPaths.contains(path, true))
+            {
+                std::cerr << "Refusing to render " << files[i].getFullPathName() << ": another input also renders to " << path << std::endl;
+                succeeded = false;
+            }
+            else if (!output.getParentDirectory().createDirectory())
+            {
+                std::cerr << "Can't create " << output.getParentDirectory().getFullPathName() << std::endl;
+                succeeded = false;
+            }
+
+            usedPaths.add(path);
+            outputFiles.add(output);
+        }
+
+        return succeeded;
+    }
+
+    //==============================================================================
+    // Long enough for several segments with their pre-roll, short enough to hold in memory
+    constexpr double verifySeconds = 20.0;
+    constexpr double verifySegmentSeconds = 4.0;
+
+    /** Renders the start of the file serially and in segments, and measures the largest difference. */
+    bool verifySegmented(const OfflineRenderer &renderer, const juce::File &file, juce::ThreadPool &pool,
+                         const OfflineRenderer::SegmentOptions &options, float &maxError)
+    {
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+        if (reader == nullptr || reader->numChannels < 1)
+            return false;
+
+        auto numSamples = static_cast<int>(juce::jmin(reader->lengthInSamples, (juce::int64)(verifySeconds * reader->sampleRate)));
+        juce::AudioBuffer<float> serial(static_cast<int>(reader->numChannels), numSamples);
+        if (!reader->read(&serial, 0, numSamples, 0, true, true))
+            return false;
+
+        juce::AudioBuffer<float> segmented;
+        segmented.makeCopyOf(serial);
+
+        renderer.render(serial, reader->sampleRate, reader->getChannelLayout());
+        renderer.renderSegmented(segmented, reader->sampleRate, pool, options, reader->getChannelLayout());
+
+        for (int channel = 0; channel < segmented.getNumChannels(); ++channel)
+            segmented.addFrom(channel, 0, serial, channel, 0, numSamples, -1.0f);
+
+        maxError = segmented.getMagnitude(0, numSamples);
+        return true;
+    }
+
+    int runVerify(const OfflineRenderer &renderer, const juce::Array<juce::File> &files, const Settings &settings)
+    {
+        OfflineRenderer::SegmentOptions options;
+        options.segmentSeconds = settings.segmentSeconds > 0.0 ? settings.segmentSeconds : verifySegmentSeconds;
+
+        juce::ThreadPool pool(settings.numThreads);
+        int numVerified = 0;
+
+        std::cout << "file,maxError,maxErrorDecibels" << std::endl;
+
+        for (auto &file : files)
+        {
+            auto maxError = 0.0f;
+            if (!verifySegmented(renderer, file, pool, options, maxError))
+            {
+                std::cerr << "Failed " << file.getFullPathName() << ": unreadable audio file" << std::endl;
+                continue;
+            }
+
+            ++numVerified;
+            std::cout << file.getFileName() << "," << maxError << "," << juce::Decibels::gainToDecibels(maxError) << std::endl;
+        }
+
+        return numVerified == files.size() ? 0 : 1;
+    }
+}
+
+//==============================================================================
+int main(int argc, char **argv)
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(juce::String::fromUTF8(argv[i]));
+
+    Settings settings;
+    if (!parseArguments(args, settings))
+    {
+        std::cerr << "Usage: SemanticEQBatchRender (--prompt <text> | --chain <file.json>) --output <directory>" << std::endl
+                  << "                            [--threads <n>] [--block-size <n>] [--segment-seconds <s>] [--local]" << std::endl
+                  << "                            [--verify] <files or directories>..." << std::endl;
+        return 1;
+    }
+
+    ChainDescription chain;
+    if (!resolveChain(settings, chain))
+    {
+        std::cerr << "Couldn't resolve an effect chain" << std::endl;
+        return 1;
+    }
+
+    auto report = ChainOptimiser::optimise(chain);
+    if (report.getNumEliminated() > 0)
+        std::cerr << "Optimised away " << report.getNumEliminated() << " of " << report.numStagesBefore << " stages" << std::endl;
+
+    juce::StringArray outputPaths;
+    auto files = collectInputFiles(settings.inputs, outputPaths);
+    if (files.isEmpty() || (!settings.verify && !settings.outputDirectory.createDirectory()))
+    {
+        std::cerr << "Nothing to render" << std::endl;
+        return 1;
+    }
+
+    OfflineRenderer renderer(chain, settings.blockSize);
+
+    if (settings.verify)
+        return runVerify(renderer, files, settings);
+
+    juce::Array<juce::File> outputFiles;
+    if (!resolveOutputFiles(files, outputPaths, settings.outputDirectory, outputFiles))
+        return 1;
+
+    std::vector<OfflineRenderer::Result> results((size_t)files.size());
+
+    juce::ThreadPool pool(settings.segmentSeconds > 0.0 ? settings.numThreads : juce::jmin(settings.numThreads, files.size()));
+    auto start = juce::Time::getHighResolutionTicks();
+
+    if (settings.segmentSeconds > 0.0)
+    {
+        // One file at a time, its segments spread over the pool
+        OfflineRenderer::SegmentOptions options;
+        options.segmentSeconds = settings.segmentSeconds;
+
+        for (int i = 0; i < files.size(); ++i)
+            results[(size_t)i] = renderer.renderFileSegmented(files[i], outputFiles[i], pool, options);
+    }
+    else
+    {
+        // One file per job, so workers never share chain state
+        std::atomic<int> remaining{files.size()};
+        juce::WaitableEvent finished;
+
+        for (int i = 0; i < files.size(); ++i)
+        {
+            pool.addJob([&, i]
+                        {
+                            results[(size_t)i] = renderer.renderFile(files[i], outputFiles[i]);
+
+                            if (--remaining == 0)
+                                finished.signal();
+                        });
+        }
+
+        finished.wait(-1);
+    }
+
+    auto wallSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+    int numRendered = 0;
+    double audioSeconds = 0.0;
+
+    for (int i = 0; i < files.size(); ++i)
+    {
+        auto &result = results[(size_t)i];
+        if (result.succeeded)
+        {
+            ++numRendered;
+            audioSeconds += result.getAudioSeconds();
+        }
+        else
+        {
+            std::cerr << "Failed " << files[i].getFullPathName() << ": " << result.error << std::endl;
+        }
+    }
+
+    std::cout << "files,threads,wallSeconds,audioSeconds,filesPerSecond,realTimeFactor" << std::endl
+              << numRendered << "," << pool.getNumThreads() << "," << wallSeconds << "," << audioSeconds << ","
+              << numRendered / wallSeconds << "," << audioSeconds / wallSeconds << std::endl;
+
+    return numRendered == files.size() ? 0 : 1;
+}
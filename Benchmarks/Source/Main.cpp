@@ -0,0 +1,605 @@
+/*
+  ==============================================================================
+
+    Benchmarks for the SemanticEQ processing paths.
+
+    Every stage type and a few typical chains are timed at each sample rate
+    and block size, once through an AudioProcessorGraph of the legacy
+    per-effect processors and once through the compiled EffectChain. Results
+    are printed as CSV on stdout, one row per measurement.
+
+    --server instead runs the parameter server client against a stand-in
+    server on a local port: a kept-alive connection, one the server closes
+    without saying so, a chunked body, and a body that trickles in slower
+    than the request deadline allows.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <csignal>
+#include "../../Source/ParameterServerClient.h"
+#include "../../Source/PluginProcessor.h"
+
+namespace
+{
+    const double sampleRates[] = {44100.0, 48000.0, 88200.0, 96000.0, 192000.0};
+    const int blockSizes[] = {16, 32, 64, 128, 256, 512, 1024, 2048, 4096};
+
+    const float filterFrequencies[] = {80.0f, 250.0f, 700.0f, 1500.0f, 3000.0f, 6000.0f, 10000.0f, 14000.0f};
+
+    StageDescription makeStage(StageType type, std::initializer_list<float> parameters)
+    {
+        StageDescription stage;
+        stage.type = type;
+        std::copy(parameters.begin(), parameters.end(), stage.parameters.begin());
+        return stage;
+    }
+
+    ChainDescription makeFilterChain(int numFilters)
+    {
+        ChainDescription chain;
+        for (int i = 0; i < numFilters; ++i)
+        {
+            auto type = i == 0 ? StageType::lowShelfFilter : StageType::peakFilter;
+            chain.stages.push_back(makeStage(type, {filterFrequencies[i % juce::numElementsInArray(filterFrequencies)], 0.9f, i % 2 == 0 ? 3.0f : -4.5f}));
+        }
+        return chain;
+    }
+
+    // Typical parameters for each stage type, in the server's parameter order
+    StageDescription makeTypicalStage(StageType type)
+    {
+        switch (type)
+        {
+        case StageType::reverb:
+            return makeStage(type, {0.7f, 0.4f, 0.3f, 1.0f});
+        case StageType::compressor:
+            return makeStage(type, {-18.0f, 4.0f, 10.0f, 100.0f});
+        case StageType::delayLine:
+            return makeStage(type, {4800.0f, 48000.0f});
+        case StageType::phaser:
+            return makeStage(type, {0.5f, 0.8f, 1000.0f, 0.5f, 0.5f});
+        case StageType::chorus:
+            return makeStage(type, {0.8f, 0.4f, 8.0f, 0.2f, 0.5f});
+        case StageType::convolutionReverb:
+            return makeStage(type, {static_cast<float>(ImpulseResponseCache::findIndex("hall")), 0.3f});
+        case StageType::lowShelfFilter:
+        case StageType::highShelfFilter:
+        case StageType::peakFilter:
+        default:
+            return makeStage(type, {1000.0f, 0.9f, 3.0f});
+        }
+    }
+
+    struct BenchmarkCase
+    {
+        juce::String name;
+        ChainDescription chain;
+    };
+
+    std::vector<BenchmarkCase> makeBenchmarkCases()
+    {
+        std::vector<BenchmarkCase> cases;
+
+        for (auto type : {StageType::peakFilter, StageType::reverb, StageType::compressor,
+                          StageType::delayLine, StageType::phaser, StageType::chorus, StageType::convolutionReverb})
+        {
+            ChainDescription chain;
+            chain.stages.push_back(makeTypicalStage(type));
+            cases.push_back({juce::String("stage:") + StageDescription::getTypeName(type), chain});
+        }
+
+        for (int numFilters : {2, 4, 8})
+            cases.push_back({"chain:filters" + juce::String(numFilters), makeFilterChain(numFilters)});
+
+        // The shape prompts usually produce: tone shaping, dynamics, then space
+        auto vocal = makeFilterChain(3);
+        vocal.stages.push_back(makeTypicalStage(StageType::compressor));
+        vocal.stages.push_back(makeTypicalStage(StageType::reverb));
+        cases.push_back({"chain:vocal", vocal});
+
+        ChainDescription everything = makeFilterChain(4);
+        for (auto type : {StageType::compressor, StageType::phaser, StageType::chorus, StageType::delayLine, StageType::reverb})
+            everything.stages.push_back(makeTypicalStage(type));
+        cases.push_back({"chain:everything", everything});
+
+        // Heavy independent branches: where the worker pool should pay off
+        auto sends = std::make_shared<std::vector<BranchDescription>>();
+        sends->push_back({1.0f, {}});
+        sends->push_back({0.3f, {makeTypicalStage(StageType::reverb)}});
+        sends->push_back({0.5f, {makeTypicalStage(StageType::compressor), makeTypicalStage(StageType::chorus)}});
+        sends->push_back({0.3f, {makeTypicalStage(StageType::delayLine), makeTypicalStage(StageType::reverb)}});
+
+        StageDescription parallel;
+        parallel.type = StageType::parallel;
+        parallel.branches = std::move(sends);
+
+        ChainDescription branched = makeFilterChain(2);
+        branched.stages.push_back(parallel);
+        cases.push_back({"chain:parallel", branched});
+
+        return cases;
+    }
+
+    // Parallel branches and convolution came after the per-node processors
+    bool hasLegacyEquivalent(const ChainDescription &chain)
+    {
+        return std::none_of(chain.stages.begin(), chain.stages.end(), [](const StageDescription &stage)
+                            { return stage.type == StageType::parallel || stage.type == StageType::convolutionReverb; });
+    }
+
+    // Only these have a linear-phase path worth comparing
+    bool hasFilters(const ChainDescription &chain)
+    {
+        return std::any_of(chain.stages.begin(), chain.stages.end(), [](const StageDescription &stage)
+                           { return StageDescription::isFilter(stage.type); });
+    }
+
+    void fillWithNoise(juce::AudioBuffer<float> &buffer)
+    {
+        juce::Random random(1234);
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                buffer.setSample(channel, i, random.nextFloat() * 2.0f - 1.0f);
+    }
+
+    std::unique_ptr<juce::AudioProcessor> makeProcessor(const StageDescription &stage)
+    {
+        auto &p = stage.parameters;
+
+        switch (stage.type)
+        {
+        case StageType::reverb:
+            return std::make_unique<ReverbProcessor>(p[0], p[1], p[2], p[3]);
+        case StageType::compressor:
+            return std::make_unique<CompressorProcessor>(p[0], p[1], p[2], p[3]);
+        case StageType::delayLine:
+            return std::make_unique<DelayLineProcessor>(p[0], p[1]);
+        case StageType::phaser:
+            return std::make_unique<PhaserProcessor>(p[0], p[1], p[2], p[3], p[4]);
+        case StageType::chorus:
+            return std::make_unique<ChorusProcessor>(p[0], p[1], p[2], p[3], p[4]);
+        case StageType::peakFilter:
+        case StageType::lowShelfFilter:
+        case StageType::highShelfFilter:
+        default:
+            return std::make_unique<FilterProcessor>(StageDescription::getTypeName(stage.type), p[0], p[1], p[2]);
+        }
+    }
+
+    // The per-node path the plugin used before chains were compiled: one
+    // processor node per stage, wired in series in a graph
+    std::unique_ptr<juce::AudioProcessorGraph> makeGraph(const ChainDescription &chain, double sampleRate, int blockSize)
+    {
+        using IOProcessor = juce::AudioProcessorGraph::AudioGraphIOProcessor;
+
+        auto graph = std::make_unique<juce::AudioProcessorGraph>();
+        graph->setPlayConfigDetails(2, 2, sampleRate, blockSize);
+
+        auto prevNode = graph->addNode(std::make_unique<IOProcessor>(IOProcessor::audioInputNode));
+        auto outputNode = graph->addNode(std::make_unique<IOProcessor>(IOProcessor::audioOutputNode));
+
+        for (auto &stage : chain.stages)
+        {
+            auto node = graph->addNode(makeProcessor(stage));
+            for (int channel = 0; channel < 2; ++channel)
+                graph->addConnection({{prevNode->nodeID, channel}, {node->nodeID, channel}});
+            prevNode = node;
+        }
+
+        for (int channel = 0; channel < 2; ++channel)
+            graph->addConnection({{prevNode->nodeID, channel}, {outputNode->nodeID, channel}});
+
+        graph->prepareToPlay(sampleRate, blockSize);
+        return graph;
+    }
+
+    template <typename ProcessFn>
+    double measureNanosecondsPerSample(int blockSize, ProcessFn &&processBlock, int numChannels = 2)
+    {
+        constexpr int totalSamples = 1 << 20;
+        constexpr int numSourceBlocks = 8;
+        auto numBlocks = juce::jmax(1, totalSamples / blockSize);
+
+        // Every block starts from fresh noise. Processing the previous output
+        // again would let boosts run away to inf/NaN and cuts decay into
+        // denormals, neither of which is what real audio costs.
+        juce::AudioBuffer<float> source(numChannels, blockSize * numSourceBlocks);
+        fillWithNoise(source);
+
+        juce::AudioBuffer<float> buffer(numChannels, blockSize);
+
+        auto loadBlock = [&](int index)
+        {
+            auto offset = (index % numSourceBlocks) * blockSize;
+            for (int channel = 0; channel < numChannels; ++channel)
+                buffer.copyFrom(channel, 0, source, channel, offset, blockSize);
+        };
+
+        // Warm up caches and processor state before timing
+        for (int i = 0; i < numBlocks / 10 + 1; ++i)
+        {
+            loadBlock(i);
+            processBlock(buffer);
+        }
+
+        auto start = juce::Time::getHighResolutionTicks();
+        for (int i = 0; i < numBlocks; ++i)
+        {
+            loadBlock(i);
+            processBlock(buffer);
+        }
+        auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+        // The copies alone, subtracted so only the processing is reported
+        start = juce::Time::getHighResolutionTicks();
+        for (int i = 0; i < numBlocks; ++i)
+            loadBlock(i);
+        auto copyElapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+        return juce::jmax(0.0, elapsed - copyElapsed) * 1.0e9 / (static_cast<double>(numBlocks) * blockSize);
+    }
+
+    void printResult(const BenchmarkCase &benchmark, double sampleRate, int blockSize, const char *path, double nsPerSample)
+    {
+        // Samples are per channel, so realtime fraction is CPU time over audio time
+        auto realtimeFraction = nsPerSample * 1.0e-9 * sampleRate;
+
+        std::cout << benchmark.name << "," << benchmark.chain.stages.size() << "," << sampleRate << "," << blockSize << ","
+                  << path << "," << nsPerSample << "," << realtimeFraction << std::endl;
+    }
+
+    // Direct path only, since the legacy processors are stereo. Costs are per
+    // sample frame, so ideal scaling is linear in the channel count.
+    void runChannelBenchmarks(const juce::String &nameFilter)
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 512;
+
+        std::cout << "benchmark,channels,sampleRate,blockSize,nsPerFrame,nsPerChannelSample" << std::endl;
+
+        for (auto &benchmark : makeBenchmarkCases())
+        {
+            if (nameFilter.isNotEmpty() && !benchmark.name.contains(nameFilter))
+                continue;
+
+            for (int numChannels : {1, 2, 6, 8, 12, 16})
+            {
+                EffectChain compiled(benchmark.chain, {sampleRate, static_cast<juce::uint32>(blockSize), static_cast<juce::uint32>(numChannels)});
+                auto ns = measureNanosecondsPerSample(blockSize, [&](juce::AudioBuffer<float> &buffer)
+                                                      {
+                                                          juce::dsp::AudioBlock<float> block(buffer);
+                                                          compiled.process(block);
+                                                      },
+                                                      numChannels);
+
+                std::cout << benchmark.name << "," << numChannels << "," << sampleRate << "," << blockSize << ","
+                          << ns << "," << ns / numChannels << std::endl;
+            }
+        }
+    }
+
+    void runBenchmarks(const juce::String &nameFilter)
+    {
+        std::cout << "benchmark,describedStages,sampleRate,blockSize,path,nsPerSample,realtimeFraction" << std::endl;
+
+        for (auto &benchmark : makeBenchmarkCases())
+        {
+            if (nameFilter.isNotEmpty() && !benchmark.name.contains(nameFilter))
+                continue;
+
+            for (auto sampleRate : sampleRates)
+            {
+                for (auto blockSize : blockSizes)
+                {
+                    if (hasLegacyEquivalent(benchmark.chain))
+                    {
+                        auto graph = makeGraph(benchmark.chain, sampleRate, blockSize);
+                        juce::MidiBuffer midi;
+                        auto graphNs = measureNanosecondsPerSample(blockSize, [&](juce::AudioBuffer<float> &buffer)
+                                                                   { graph->processBlock(buffer, midi); });
+                        printResult(benchmark, sampleRate, blockSize, "graph", graphNs);
+                    }
+
+                    EffectChain compiled(benchmark.chain, {sampleRate, static_cast<juce::uint32>(blockSize), 2});
+                    auto directNs = measureNanosecondsPerSample(blockSize, [&](juce::AudioBuffer<float> &buffer)
+                                                                {
+                                                                    juce::dsp::AudioBlock<float> block(buffer);
+                                                                    compiled.process(block);
+                                                                });
+                    printResult(benchmark, sampleRate, blockSize, "direct", directNs);
+
+                    if (hasFilters(benchmark.chain))
+                    {
+                        EffectChain linear(benchmark.chain, {sampleRate, static_cast<juce::uint32>(blockSize), 2},
+                                           EffectChain::FilterMode::linearPhase);
+                        auto linearNs = measureNanosecondsPerSample(blockSize, [&](juce::AudioBuffer<float> &buffer)
+                                                                    {
+                                                                        juce::dsp::AudioBlock<float> block(buffer);
+                                                                        linear.process(block);
+                                                                    });
+                        printResult(benchmark, sampleRate, blockSize, "linearPhase", linearNs);
+                    }
+                }
+            }
+        }
+    }
+
+    //==============================================================================
+    // In the server's schema, long enough to span several chunks
+    const char *const standInResponse = R"({"effects":[)"
+                                        R"({"type":"peakFilter","centreFrequency":1000.0,"Q":0.7,"gainFactor":3.0},)"
+                                        R"({"type":"reverb","roomSize":0.5,"damping":0.4,"wetLevel":0.25,"width":1.0}]})";
+
+    /** True if the body is the stand-in response byte for byte and parses into the chain it describes. */
+    bool isStandInResponse(const juce::String &body)
+    {
+        ChainDescription chain;
+        if (body != standInResponse || !ChainDescription::fromJSON(juce::JSON::parse(body), chain))
+            return false;
+
+        const StageDescription expected[] = {
+            makeStage(StageType::peakFilter, {1000.0f, 0.7f, 3.0f}),
+            makeStage(StageType::reverb, {0.5f, 0.4f, 0.25f, 1.0f})};
+
+        if (chain.stages.size() != (size_t)juce::numElementsInArray(expected))
+            return false;
+
+        for (size_t i = 0; i < chain.stages.size(); ++i)
+            if (chain.stages[i].type != expected[i].type || chain.stages[i].parameters != expected[i].parameters)
+                return false;
+
+        return true;
+    }
+
+    /** Answers POSTs on a local port the ways a parameter server might, so the client can be checked against each. */
+    class StandInServer : public juce::Thread
+    {
+    public:
+        enum class Mode
+        {
+            keepAlive,        // Content-Length, connection kept open
+            closeUnannounced, // keep-alive promised, but the connection is closed after every reply
+            chunked,          // chunked body, written a chunk at a time
+            trickle           // headers, then one byte of the body every tricklePeriodMs
+        };
+
+        explicit StandInServer(Mode modeIn)
+            : juce::Thread("Stand-in parameter server"),
+              mode(modeIn)
+        {
+            listener.createListener(0, "127.0.0.1");
+            startThread();
+        }
+
+        ~StandInServer() override
+        {
+            signalThreadShouldExit();
+            listener.close();
+            stopThread(2000);
+        }
+
+        int getPort() const { return listener.getBoundPort(); }
+        int getNumConnections() const { return numConnections; }
+
+        void run() override
+        {
+            while (!threadShouldExit())
+            {
+                std::unique_ptr<juce::StreamingSocket> connection(listener.waitForNextConnection());
+                if (connection == nullptr)
+                    return;
+
+                ++numConnections;
+                while (!threadShouldExit() && readRequest(*connection) && respond(*connection))
+                {
+                }
+            }
+        }
+
+        static constexpr int tricklePeriodMs = 100;
+
+    private:
+        bool readRequest(juce::StreamingSocket &connection)
+        {
+            std::string request;
+            std::string::size_type headerEnd;
+            char chunk[1024];
+
+            auto receive = [&]
+            {
+                if (connection.waitUntilReady(true, 5000) != 1)
+                    return false;
+
+                auto numRead = connection.read(chunk, (int)sizeof(chunk), false);
+                if (numRead <= 0)
+                    return false;
+
+                request.append(chunk, (size_t)numRead);
+                return true;
+            };
+
+            while ((headerEnd = request.find("\r\n\r\n")) == std::string::npos)
+                if (!receive())
+                    return false;
+
+            auto headers = juce::String(request.substr(0, headerEnd));
+            auto contentLength = headers.fromFirstOccurrenceOf("Content-Length:", false, true).getIntValue();
+
+            while (request.size() < headerEnd + 4 + (size_t)contentLength)
+                if (!receive())
+                    return false;
+
+            return true;
+        }
+
+        bool respond(juce::StreamingSocket &connection)
+        {
+            auto body = juce::String(standInResponse);
+            auto bodySize = static_cast<int>(body.getNumBytesAsUTF8());
+
+            auto write = [&connection](const juce::String &text)
+            {
+                auto size = static_cast<int>(text.getNumBytesAsUTF8());
+                return connection.write(text.toRawUTF8(), size) == size;
+            };
+
+            switch (mode)
+            {
+            case Mode::keepAlive:
+                return write("HTTP/1.1 200 OK\r\nContent-Length: " + juce::String(bodySize) + "\r\n\r\n" + body);
+
+            case Mode::closeUnannounced:
+                write("HTTP/1.1 200 OK\r\nContent-Length: " + juce::String(bodySize) + "\r\n\r\n" + body);
+                return false;
+
+            case Mode::chunked:
+            {
+                if (!write("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"))
+                    return false;
+
+                for (int start = 0; start < bodySize; start += 7)
+                {
+                    auto piece = body.substring(start, start + 7);
+                    if (!write(juce::String::toHexString(piece.length()) + "\r\n" + piece + "\r\n"))
+                        return false;
+
+                    juce::Thread::sleep(1);
+                }
+
+                return write("0\r\n\r\n");
+            }
+
+            case Mode::trickle:
+            {
+                if (!write("HTTP/1.1 200 OK\r\nContent-Length: " + juce::String(bodySize) + "\r\n\r\n"))
+                    return false;
+
+                for (int i = 0; i < bodySize && !threadShouldExit(); ++i)
+                {
+                    juce::Thread::sleep(tricklePeriodMs);
+                    if (!write(body.substring(i, i + 1)))
+                        return false;
+                }
+
+                return false;
+            }
+            }
+
+            return false;
+        }
+
+        Mode mode;
+        juce::StreamingSocket listener;
+        std::atomic<int> numConnections{0};
+    };
+
+    /**
+        Runs the parameter server client against each kind of stand-in server
+        and prints one CSV row per case. Returns false if any case went wrong.
+     */
+    bool runServerChecks()
+    {
+#if !JUCE_WINDOWS
+        // The stand-in server writes to connections the client has already dropped
+        std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+        constexpr int numRequests = 8;
+
+        struct Case
+        {
+            const char *name;
+            StandInServer::Mode mode;
+            int expectedConnections;
+        };
+
+        const Case cases[] = {
+            {"keepAlive", StandInServer::Mode::keepAlive, 1},
+            {"closeUnannounced", StandInServer::Mode::closeUnannounced, numRequests},
+            {"chunked", StandInServer::Mode::chunked, 1}};
+
+        auto allPassed = true;
+        std::cout << "case,requests,correct,connections,msPerRequest,passed" << std::endl;
+
+        for (auto &c : cases)
+        {
+            StandInServer server(c.mode);
+
+            ParameterServerClient::Options options;
+            options.port = server.getPort();
+            ParameterServerClient client(options);
+
+            int numCorrect = 0;
+            auto start = juce::Time::getHighResolutionTicks();
+
+            for (int i = 0; i < numRequests; ++i)
+            {
+                juce::String response;
+                if (client.post(R"({"query":"warm"})", response) && isStandInResponse(response))
+                    ++numCorrect;
+            }
+
+            auto ms = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0 / numRequests;
+            auto passed = numCorrect == numRequests && server.getNumConnections() == c.expectedConnections;
+            allPassed = allPassed && passed;
+
+            std::cout << c.name << "," << numRequests << "," << numCorrect << "," << server.getNumConnections() << ","
+                      << ms << "," << (passed ? "yes" : "no") << std::endl;
+        }
+
+        // A byte at a time never trips the read timeout, only the request deadline
+        {
+            StandInServer server(StandInServer::Mode::trickle);
+
+            ParameterServerClient::Options options;
+            options.port = server.getPort();
+            options.readTimeoutMs = 4 * StandInServer::tricklePeriodMs;
+            options.requestTimeoutMs = 10 * StandInServer::tricklePeriodMs;
+            ParameterServerClient client(options);
+
+            juce::String response;
+            auto start = juce::Time::getHighResolutionTicks();
+            auto answered = client.post(R"({"query":"warm"})", response);
+            auto ms = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0;
+
+            auto passed = !answered && ms < 2.0 * options.requestTimeoutMs;
+            allPassed = allPassed && passed;
+
+            std::cout << "trickle,1," << (answered ? 1 : 0) << "," << server.getNumConnections() << ","
+                      << ms << "," << (passed ? "yes" : "no") << std::endl;
+        }
+
+        return allPassed;
+    }
+}
+
+//==============================================================================
+int main(int argc, char **argv)
+{
+    // AudioProcessorGraph needs a message manager for its async updates
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ScopedNoDenormals noDenormals;
+
+    // Optional argument: only run benchmarks whose name contains it, e.g. "stage:" or "reverb".
+    // "--channels" runs the channel-count scaling table instead, and "--server"
+    // checks the parameter server client against a local stand-in server.
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(juce::String::fromUTF8(argv[i]));
+
+    if (args.contains("--server"))
+        return runServerChecks() ? 0 : 1;
+
+    auto channelScaling = args.contains("--channels");
+    args.removeString("--channels");
+    auto nameFilter = args.isEmpty() ? juce::String() : args[0];
+
+    if (channelScaling)
+        runChannelBenchmarks(nameFilter);
+    else
+        runBenchmarks(nameFilter);
+
+    return 0;
+}
@@ -0,0 +1,156 @@
+/*
+  ==============================================================================
+
+    Cascade of second-order sections with per-channel state, vectorised across
+    channels: each SIMD lane carries one channel.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Channels are processed in groups of SIMD width. For each group the block is
+    interleaved once, every section then runs as one pass over the interleaved
+    samples while they are still in cache, and the result is de-interleaved.
+    Sections use the same transposed direct form II as juce::dsp::IIR::Filter.
+    Any channel count works: a 7.1.4 block is three groups of four lanes with
+    SSE or NEON, and a partly used last group is padded with silence.
+ */
+class BiquadCascade
+{
+public:
+  /** Normalised coefficients, i.e. a0 == 1. */
+  struct Coefficients
+  {
+    float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a1 = 0.0f, a2 = 0.0f;
+  };
+
+#if JUCE_USE_SIMD
+  using Lanes = juce::dsp::SIMDRegister<float>;
+  static constexpr int laneCount = static_cast<int>(Lanes::SIMDNumElements);
+#else
+  using Lanes = float;
+  static constexpr int laneCount = 1;
+#endif
+
+  //==============================================================================
+  void prepare(int numChannelsIn, int maximumBlockSizeIn, int numSectionsIn)
+  {
+    numChannels = numChannelsIn;
+    maximumBlockSize = juce::jmax(1, maximumBlockSizeIn);
+    numSections = numSectionsIn;
+    numGroups = (numChannels + laneCount - 1) / laneCount;
+
+    coefficients.resize((size_t)numSections);
+    state.assign((size_t)(numGroups * numSections * 2), broadcast(0.0f));
+    interleaved.assign((size_t)maximumBlockSize, broadcast(0.0f));
+  }
+
+  void setCoefficients(int section, const Coefficients &newCoefficients)
+  {
+    coefficients[(size_t)section] = newCoefficients;
+  }
+
+  void reset()
+  {
+    std::fill(state.begin(), state.end(), broadcast(0.0f));
+  }
+
+  //==============================================================================
+  void process(juce::dsp::AudioBlock<float> &block)
+  {
+    auto numSamples = static_cast<int>(block.getNumSamples());
+    auto channels = juce::jmin(numChannels, static_cast<int>(block.getNumChannels()));
+
+    for (int start = 0; start < numSamples; start += maximumBlockSize)
+    {
+      auto n = juce::jmin(maximumBlockSize, numSamples - start);
+
+      for (int group = 0; group < numGroups; ++group)
+      {
+        auto firstChannel = group * laneCount;
+        auto groupChannels = juce::jmin(laneCount, channels - firstChannel);
+        if (groupChannels <= 0)
+          break;
+
+        interleave(block, firstChannel, groupChannels, start, n);
+
+        auto *groupState = state.data() + group * numSections * 2;
+        for (int section = 0; section < numSections; ++section)
+          processSection(coefficients[(size_t)section], groupState + section * 2, n);
+
+        deinterleave(block, firstChannel, groupChannels, start, n);
+      }
+    }
+  }
+
+  int getNumSections() const { return numSections; }
+
+private:
+  //==============================================================================
+  static Lanes broadcast(float value)
+  {
+#if JUCE_USE_SIMD
+    return Lanes::expand(value);
+#else
+    return value;
+#endif
+  }
+
+  void processSection(const Coefficients &c, Lanes *sectionState, int n)
+  {
+    auto b0 = broadcast(c.b0), b1 = broadcast(c.b1), b2 = broadcast(c.b2);
+    auto a1 = broadcast(c.a1), a2 = broadcast(c.a2);
+    auto s1 = sectionState[0], s2 = sectionState[1];
+
+    auto *samples = interleaved.data();
+    for (int i = 0; i < n; ++i)
+    {
+      auto x = samples[i];
+      auto y = b0 * x + s1;
+      s1 = b1 * x - a1 * y + s2;
+      s2 = b2 * x - a2 * y;
+      samples[i] = y;
+    }
+
+    sectionState[0] = s1;
+    sectionState[1] = s2;
+  }
+
+  void interleave(juce::dsp::AudioBlock<float> &block, int firstChannel, int groupChannels, int start, int n)
+  {
+    auto *lanes = reinterpret_cast<float *>(interleaved.data());
+
+    // Earlier groups leave their samples in the lanes this one doesn't use
+    if (groupChannels < laneCount)
+      std::fill(interleaved.begin(), interleaved.begin() + n, broadcast(0.0f));
+
+    for (int c = 0; c < groupChannels; ++c)
+    {
+      auto *src = block.getChannelPointer((size_t)(firstChannel + c)) + start;
+      for (int i = 0; i < n; ++i)
+        lanes[i * laneCount + c] = src[i];
+    }
+  }
+
+  void deinterleave(juce::dsp::AudioBlock<float> &block, int firstChannel, int groupChannels, int start, int n)
+  {
+    auto *lanes = reinterpret_cast<const float *>(interleaved.data());
+    for (int c = 0; c < groupChannels; ++c)
+    {
+      auto *dst = block.getChannelPointer((size_t)(firstChannel + c)) + start;
+      for (int i = 0; i < n; ++i)
+        dst[i] = lanes[i * laneCount + c];
+    }
+  }
+
+  //==============================================================================
+  std::vector<Coefficients> coefficients;
+  std::vector<Lanes> state;
+  std::vector<Lanes> interleaved;
+  int numChannels = 0, maximumBlockSize = 0, numSections = 0, numGroups = 0;
+};
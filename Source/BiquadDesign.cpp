@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    Peak and shelf filter design that writes straight into caller-owned
+    storage, plus a process-wide cache of designed coefficients.
+
+  ==============================================================================
+*/
+
+#include "BiquadDesign.h"
+#include "RealtimeWatchdog.h"
+
+//==============================================================================
+size_t CoefficientCache::hash(const Key &key) noexcept
+{
+    auto mix = [](juce::uint64 h, juce::uint64 value)
+    {
+        h ^= value + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+        return h;
+    };
+
+    auto bits = [](auto value)
+    {
+        juce::uint64 result = 0;
+        std::memcpy(&result, &value, sizeof(value));
+        return result;
+    };
+
+    juce::uint64 h = static_cast<juce::uint64>(key.type);
+    h = mix(h, bits(key.frequency));
+    h = mix(h, bits(key.Q));
+    h = mix(h, bits(key.gainDecibels));
+    h = mix(h, bits(key.sampleRate));
+    return static_cast<size_t>(h);
+}
+
+void CoefficientCache::getCoefficients(StageType type, double sampleRate, float frequency, float Q, float gainDecibels,
+                                       BiquadCascade::Coefficients &result)
+{
+    Key key{type, frequency, Q, gainDecibels, sampleRate};
+    auto first = hash(key);
+
+    {
+        SEMANTICEQ_RT_NOTE_LOCK("CoefficientCache::lock");
+        const juce::SpinLock::ScopedLockType sl(lock);
+        ++clock;
+
+        for (int i = 0; i < probeLength; ++i)
+        {
+            auto &entry = entries[(first + (size_t)i) % capacity];
+            if (entry.used && entry.key == key)
+            {
+                entry.lastUsed = clock;
+                result = entry.coefficients;
+                ++hits;
+                return;
+            }
+        }
+    }
+
+    // Design outside the lock; two threads missing on the same key just both
+    // compute it
+    BiquadDesign::design(type, sampleRate, frequency, Q, gainDecibels, result);
+    ++misses;
+
+    const juce::SpinLock::ScopedLockType sl(lock);
+    auto *victim = &entries[first % capacity];
+    for (int i = 0; i < probeLength; ++i)
+    {
+        auto &entry = entries[(first + (size_t)i) % capacity];
+        if (!entry.used)
+        {
+            victim = &entry;
+            break;
+        }
+
+        if (entry.lastUsed < victim->lastUsed)
+            victim = &entry;
+    }
+
+    victim->key = key;
+    victim->coefficients = result;
+    victim->lastUsed = clock;
+    victim->used = true;
+}
@@ -0,0 +1,135 @@
+/*
+  ==============================================================================
+
+    Peak and shelf filter design that writes straight into caller-owned
+    storage, plus a process-wide cache of designed coefficients.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "BiquadCascade.h"
+#include "ChainDescription.h"
+
+//==============================================================================
+/**
+    Same RBJ cookbook formulas as juce::dsp::IIR::Coefficients::makePeakFilter,
+    makeLowShelf and makeHighShelf, without the heap-allocated coefficients
+    object. gainDecibels is converted to a linear gain factor as the server's
+    gainFactor always has been.
+ */
+struct BiquadDesign
+{
+  static void design(StageType type, double sampleRate, float frequency, float Q, float gainDecibels,
+                     BiquadCascade::Coefficients &result) noexcept
+  {
+    auto A = std::sqrt(juce::jmax(0.0, static_cast<double>(juce::Decibels::decibelsToGain(gainDecibels))));
+    auto omega = (juce::MathConstants<double>::twoPi * juce::jmax(static_cast<double>(frequency), 2.0)) / sampleRate;
+    auto q = juce::jmax(static_cast<double>(Q), 1.0e-6);
+
+    double b0, b1, b2, a0, a1, a2;
+
+    if (type == StageType::lowShelfFilter || type == StageType::highShelfFilter)
+    {
+      auto aminus1 = A - 1, aplus1 = A + 1;
+      auto coso = std::cos(omega);
+      auto beta = std::sin(omega) * std::sqrt(A) / q;
+      auto aminus1TimesCoso = aminus1 * coso;
+
+      if (type == StageType::lowShelfFilter)
+      {
+        b0 = A * (aplus1 - aminus1TimesCoso + beta);
+        b1 = A * 2 * (aminus1 - aplus1 * coso);
+        b2 = A * (aplus1 - aminus1TimesCoso - beta);
+        a0 = aplus1 + aminus1TimesCoso + beta;
+        a1 = -2 * (aminus1 + aplus1 * coso);
+        a2 = aplus1 + aminus1TimesCoso - beta;
+      }
+      else
+      {
+        b0 = A * (aplus1 + aminus1TimesCoso + beta);
+        b1 = A * -2 * (aminus1 + aplus1 * coso);
+        b2 = A * (aplus1 + aminus1TimesCoso - beta);
+        a0 = aplus1 - aminus1TimesCoso + beta;
+        a1 = 2 * (aminus1 - aplus1 * coso);
+        a2 = aplus1 - aminus1TimesCoso - beta;
+      }
+    }
+    else
+    {
+      auto alpha = std::sin(omega) / (q * 2);
+      auto c2 = -2 * std::cos(omega);
+      auto alphaTimesA = alpha * A;
+      auto alphaOverA = alpha / A;
+
+      b0 = 1 + alphaTimesA;
+      b1 = c2;
+      b2 = 1 - alphaTimesA;
+      a0 = 1 + alphaOverA;
+      a1 = c2;
+      a2 = 1 - alphaOverA;
+    }
+
+    auto a0inv = 1.0 / a0;
+    result.b0 = static_cast<float>(b0 * a0inv);
+    result.b1 = static_cast<float>(b1 * a0inv);
+    result.b2 = static_cast<float>(b2 * a0inv);
+    result.a1 = static_cast<float>(a1 * a0inv);
+    result.a2 = static_cast<float>(a2 * a0inv);
+  }
+};
+
+//==============================================================================
+/**
+    Fixed-size table of designed coefficients keyed on (type, frequency, Q,
+    gain, sample rate). All storage lives inside the object, so lookups and
+    inserts never allocate. Share one instance per process with
+    juce::SharedResourcePointer<CoefficientCache>.
+
+    A key hashes to a short probe window; when the window is full the oldest
+    slot in it is overwritten.
+ */
+class CoefficientCache
+{
+public:
+  void getCoefficients(StageType type, double sampleRate, float frequency, float Q, float gainDecibels,
+                       BiquadCascade::Coefficients &result);
+
+  juce::int64 getNumHits() const { return hits.load(); }
+  juce::int64 getNumMisses() const { return misses.load(); }
+
+  //==============================================================================
+  static constexpr int capacity = 1024;
+  static constexpr int probeLength = 4;
+
+private:
+  struct Key
+  {
+    StageType type;
+    float frequency, Q, gainDecibels;
+    double sampleRate;
+
+    bool operator==(const Key &other) const noexcept
+    {
+      return type == other.type && frequency == other.frequency && Q == other.Q
+          && gainDecibels == other.gainDecibels && sampleRate == other.sampleRate;
+    }
+  };
+
+  struct Entry
+  {
+    Key key;
+    BiquadCascade::Coefficients coefficients;
+    juce::uint32 lastUsed = 0;
+    bool used = false;
+  };
+
+  static size_t hash(const Key &key) noexcept;
+
+  juce::SpinLock lock;
+  std::array<Entry, capacity> entries{};
+  juce::uint32 clock = 0;
+  std::atomic<juce::int64> hits{0}, misses{0};
+};
@@ -0,0 +1,448 @@
+/*
+  ==============================================================================
+
+    Plain-data description of an effect chain, as returned by the parameter
+    server. Parsed off the message thread and handed to the processor.
+
+  ==============================================================================
+*/
+
+#include "ChainDescription.h"
+#include "ImpulseResponseCache.h"
+
+namespace
+{
+    struct StageInfo
+    {
+        StageType type;
+        const char *name;
+        int numParameters;
+        const char *parameterIds[StageDescription::maxParameters];
+    };
+
+    // Keys match the JSON the server sends for each effect type
+    const StageInfo stageInfos[] = {
+        {StageType::peakFilter, "peakFilter", 3, {"centreFrequency", "Q", "gainFactor"}},
+        {StageType::lowShelfFilter, "lowShelfFilter", 3, {"cutOffFrequency", "Q", "gainFactor"}},
+        {StageType::highShelfFilter, "highShelfFilter", 3, {"cutOffFrequency", "Q", "gainFactor"}},
+        {StageType::reverb, "reverb", 4, {"roomSize", "damping", "wetLevel", "width"}},
+        {StageType::compressor, "compressor", 4, {"threshold", "ratio", "attack", "release"}},
+        {StageType::delayLine, "delayLine", 2, {"delay", "maximumDelayInSamples"}},
+        {StageType::phaser, "phaser", 5, {"rate", "depth", "centerFrequency", "feedback", "mix"}},
+        {StageType::chorus, "chorus", 5, {"rate", "depth", "centreDelay", "feedback", "mix"}},
+        {StageType::parallel, "parallel", 0, {}},
+        {StageType::convolutionReverb, "convolutionReverb", 2, {"impulseResponse", "wetLevel"}},
+    };
+
+    // Guard the parsers against corrupt or hostile input
+    constexpr int maxBinaryStages = 1024;
+    constexpr int maxBranches = 16;
+    constexpr int maxNestingDepth = 4;
+
+    const StageInfo &getStageInfo(StageType type)
+    {
+        for (auto &info : stageInfos)
+            if (info.type == type)
+                return info;
+
+        jassertfalse;
+        return stageInfos[0];
+    }
+
+    //==============================================================================
+    void parseEffects(const juce::var &jsonEffects, std::vector<StageDescription> &stages, int depth)
+    {
+        if (!jsonEffects.isArray())
+            return;
+
+        stages.reserve(stages.size() + (size_t)jsonEffects.size());
+
+        for (int i = 0; i < jsonEffects.size(); ++i)
+        {
+            juce::var effect = jsonEffects[i];
+            if (!effect.isObject())
+                continue;
+
+            StageDescription stage;
+            // Unknown effect types are skipped rather than left unconnected
+            if (!StageDescription::parseTypeName(effect["type"].toString(), stage.type))
+                continue;
+
+            for (int p = 0; p < StageDescription::getNumParameters(stage.type); ++p)
+                stage.parameters[(size_t)p] = static_cast<float>(effect[StageDescription::getParameterId(stage.type, p)]);
+
+            if (stage.type == StageType::convolutionReverb)
+            {
+                // Rooms are picked by name; an unknown room is skipped like an unknown type
+                auto room = ImpulseResponseCache::findIndex(effect["impulseResponse"].toString());
+                if (room < 0)
+                    continue;
+
+                stage.parameters[0] = static_cast<float>(room);
+            }
+
+            if (stage.type == StageType::parallel)
+            {
+                juce::var jsonBranches = effect["branches"];
+                if (depth >= maxNestingDepth || !jsonBranches.isArray())
+                    continue;
+
+                auto branches = std::make_shared<std::vector<BranchDescription>>();
+                for (int b = 0; b < juce::jmin(jsonBranches.size(), maxBranches); ++b)
+                {
+                    juce::var jsonBranch = jsonBranches[b];
+                    if (!jsonBranch.isObject())
+                        continue;
+
+                    BranchDescription branch;
+                    branch.gain = jsonBranch.hasProperty("gain") ? static_cast<float>(jsonBranch["gain"]) : 1.0f;
+                    parseEffects(jsonBranch["effects"], branch.stages, depth + 1);
+                    branches->push_back(std::move(branch));
+                }
+
+                if (branches->empty())
+                    continue;
+
+                stage.branches = std::move(branches);
+            }
+
+            stages.push_back(stage);
+        }
+    }
+
+    juce::Array<juce::var> effectsToJSON(const std::vector<StageDescription> &stages)
+    {
+        juce::Array<juce::var> jsonEffects;
+
+        for (auto &stage : stages)
+        {
+            auto *effect = new juce::DynamicObject();
+            effect->setProperty("type", StageDescription::getTypeName(stage.type));
+
+            for (int p = 0; p < StageDescription::getNumParameters(stage.type); ++p)
+                effect->setProperty(StageDescription::getParameterId(stage.type, p), stage.parameters[(size_t)p]);
+
+            if (stage.type == StageType::convolutionReverb)
+                effect->setProperty("impulseResponse", ImpulseResponseCache::getName(static_cast<int>(stage.parameters[0])));
+
+            if (stage.branches != nullptr)
+            {
+                juce::Array<juce::var> jsonBranches;
+                for (auto &branch : *stage.branches)
+                {
+                    auto *jsonBranch = new juce::DynamicObject();
+                    jsonBranch->setProperty("gain", branch.gain);
+                    jsonBranch->setProperty("effects", effectsToJSON(branch.stages));
+                    jsonBranches.add(juce::var(jsonBranch));
+                }
+                effect->setProperty("branches", jsonBranches);
+            }
+
+            jsonEffects.add(juce::var(effect));
+        }
+
+        return jsonEffects;
+    }
+
+    void writeStages(juce::OutputStream &output, const std::vector<StageDescription> &stages)
+    {
+        output.writeCompressedInt(static_cast<int>(stages.size()));
+
+        for (auto &stage : stages)
+        {
+            output.writeByte(static_cast<char>(stage.type));
+
+            for (int p = 0; p < StageDescription::getNumParameters(stage.type); ++p)
+                output.writeFloat(stage.parameters[(size_t)p]);
+
+            if (stage.type == StageType::parallel)
+            {
+                output.writeCompressedInt(static_cast<int>(stage.branches->size()));
+                for (auto &branch : *stage.branches)
+                {
+                    output.writeFloat(branch.gain);
+                    writeStages(output, branch.stages);
+                }
+            }
+        }
+    }
+
+    bool readStages(juce::InputStream &input, std::vector<StageDescription> &stages, int depth)
+    {
+        auto numStages = input.readCompressedInt();
+        if (!juce::isPositiveAndNotGreaterThan(numStages, maxBinaryStages))
+            return false;
+
+        stages.clear();
+        stages.reserve((size_t)numStages);
+
+        for (int i = 0; i < numStages; ++i)
+        {
+            if (input.isExhausted())
+                return false;
+
+            auto typeIndex = static_cast<int>(static_cast<juce::uint8>(input.readByte()));
+            if (!juce::isPositiveAndBelow(typeIndex, juce::numElementsInArray(stageInfos)))
+                return false;
+
+            StageDescription stage;
+            stage.type = static_cast<StageType>(typeIndex);
+
+            auto numParameters = StageDescription::getNumParameters(stage.type);
+            if (input.getNumBytesRemaining() < numParameters * (juce::int64)sizeof(float))
+                return false;
+
+            for (int p = 0; p < numParameters; ++p)
+                stage.parameters[(size_t)p] = input.readFloat();
+
+            if (stage.type == StageType::parallel)
+            {
+                auto numBranches = input.readCompressedInt();
+                if (depth >= maxNestingDepth || !juce::isPositiveAndNotGreaterThan(numBranches, maxBranches) || numBranches == 0)
+                    return false;
+
+                auto branches = std::make_shared<std::vector<BranchDescription>>((size_t)numBranches);
+                for (auto &branch : *branches)
+                {
+                    branch.gain = input.readFloat();
+                    if (!readStages(input, branch.stages, depth + 1))
+                        return false;
+                }
+
+                stage.branches = std::move(branches);
+            }
+
+            stages.push_back(stage);
+        }
+
+        return true;
+    }
+}
+
+//==============================================================================
+const char *StageDescription::getTypeName(StageType type)
+{
+    return getStageInfo(type).name;
+}
+
+bool StageDescription::parseTypeName(const juce::String &name, StageType &type)
+{
+    for (auto &info : stageInfos)
+    {
+        if (name == info.name)
+        {
+            type = info.type;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int StageDescription::getNumParameters(StageType type)
+{
+    return getStageInfo(type).numParameters;
+}
+
+bool StageDescription::isFilter(StageType type)
+{
+    return type == StageType::peakFilter || type == StageType::lowShelfFilter || type == StageType::highShelfFilter;
+}
+
+const char *StageDescription::getParameterId(StageType type, int index)
+{
+    jassert(juce::isPositiveAndBelow(index, getNumParameters(type)));
+    return getStageInfo(type).parameterIds[index];
+}
+
+bool StageDescription::isLogarithmic(StageType type, int index)
+{
+    // Filter frequency and Q
+    return isFilter(type) && index < 2;
+}
+
+StageDescription StageDescription::withIdentityParameters() const
+{
+    auto identity = *this;
+
+    switch (type)
+    {
+    case StageType::peakFilter:
+    case StageType::lowShelfFilter:
+    case StageType::highShelfFilter:
+        identity.parameters[2] = 0.0f; // gainFactor
+        break;
+    case StageType::reverb:
+        identity.parameters[2] = 0.0f; // wetLevel
+        identity.parameters[reverbDryTrimIndex] = juce::Decibels::gainToDecibels(0.5f); // undoes juce::Reverb's dry doubling
+        break;
+    case StageType::compressor:
+        identity.parameters[1] = 1.0f; // ratio
+        break;
+    case StageType::delayLine:
+        identity.parameters[0] = 0.0f; // delay
+        break;
+    case StageType::phaser:
+    case StageType::chorus:
+        identity.parameters[4] = 0.0f; // mix
+        break;
+    case StageType::convolutionReverb:
+        identity.parameters[1] = 0.0f; // wetLevel
+        break;
+    case StageType::parallel:
+        // A single dry branch at unity gain
+        identity.branches = std::make_shared<const std::vector<BranchDescription>>(1);
+        break;
+    }
+
+    return identity;
+}
+
+double StageDescription::getTailLengthSeconds(double sampleRate) const
+{
+    using juce::MathConstants;
+
+    // Number of passes a feedback loop with this gain needs to fall by 60 dB
+    auto getNumRepeats = [](float feedback)
+    {
+        auto gain = juce::jlimit(0.0, 0.999, std::abs(static_cast<double>(feedback)));
+        return gain > 0.0 ? std::log(1.0e-3) / std::log(gain) : 0.0;
+    };
+
+    auto &p = parameters;
+
+    switch (type)
+    {
+    case StageType::peakFilter:
+    case StageType::lowShelfFilter:
+    case StageType::highShelfFilter:
+    {
+        if (p[2] == 0.0f)
+            return 0.0;
+
+        // A resonance rings with a time constant of Q / (pi f)
+        auto frequency = juce::jmax(10.0, static_cast<double>(p[0]));
+        return std::log(1.0e3) * juce::jmax(0.1, static_cast<double>(p[1])) / (MathConstants<double>::pi * frequency);
+    }
+    case StageType::reverb:
+    {
+        if (p[2] <= 0.0f)
+            return 0.0;
+
+        // juce::Reverb's longest comb is about 37 ms long, with feedback
+        // 0.7 + 0.28 * roomSize
+        auto feedback = 0.7f + 0.28f * juce::jlimit(0.0f, 1.0f, p[0]);
+        return 0.037 * getNumRepeats(feedback);
+    }
+    case StageType::delayLine:
+        return sampleRate > 0.0 ? juce::jmax(0.0f, p[0]) / sampleRate : 0.0;
+    case StageType::phaser:
+    {
+        if (p[4] <= 0.0f)
+            return 0.0;
+
+        // Six all-pass stages around the centre frequency, recirculated
+        auto frequency = juce::jmax(10.0, static_cast<double>(p[2]));
+        return (1.0 + getNumRepeats(p[3])) * 6.0 / (MathConstants<double>::twoPi * frequency);
+    }
+    case StageType::chorus:
+    {
+        if (p[4] <= 0.0f)
+            return 0.0;
+
+        // Modulation swings the delay up to twice the centre delay
+        auto longestDelay = 2.0 * juce::jmax(0.0f, p[2]) * 1.0e-3;
+        return longestDelay * (1.0 + getNumRepeats(p[3]));
+    }
+    case StageType::compressor:
+        return 0.0; // silence in, silence out
+    case StageType::convolutionReverb:
+        return p[1] > 0.0f ? ImpulseResponseCache::getLengthSeconds(static_cast<int>(p[0])) : 0.0;
+    case StageType::parallel:
+    {
+        // The longest branch, each branch being its stages in series
+        auto longest = 0.0;
+        for (auto &branch : *branches)
+        {
+            auto branchTail = 0.0;
+            for (auto &stage : branch.stages)
+                branchTail += stage.getTailLengthSeconds(sampleRate);
+
+            if (branch.gain != 0.0f)
+                longest = juce::jmax(longest, branchTail);
+        }
+        return longest;
+    }
+    }
+
+    return 0.0;
+}
+
+bool StageDescription::canMorphBetween(const StageDescription &a, const StageDescription &b)
+{
+    if (a.type != b.type)
+        return false;
+
+    // Two rooms can't be interpolated; one fades out while the other fades in
+    return a.type != StageType::convolutionReverb || a.parameters[0] == b.parameters[0];
+}
+
+StageDescription StageDescription::interpolate(const StageDescription &a, const StageDescription &b, float amount) noexcept
+{
+    jassert(a.type == b.type);
+
+    auto result = a;
+    for (int p = 0; p < getNumParameters(a.type); ++p)
+    {
+        auto from = a.parameters[(size_t)p], to = b.parameters[(size_t)p];
+
+        if (isLogarithmic(a.type, p) && from > 0.0f && to > 0.0f)
+            result.parameters[(size_t)p] = from * std::pow(to / from, amount);
+        else
+            result.parameters[(size_t)p] = from + amount * (to - from);
+    }
+
+    // Not one of the server's parameters, but it moves with the morph all the same
+    if (a.type == StageType::reverb)
+    {
+        auto from = a.parameters[reverbDryTrimIndex], to = b.parameters[reverbDryTrimIndex];
+        result.parameters[reverbDryTrimIndex] = from + amount * (to - from);
+    }
+
+    return result;
+}
+
+//==============================================================================
+bool ChainDescription::fromJSON(const juce::var &response, ChainDescription &chain)
+{
+    if (!response.isObject())
+        return false;
+
+    juce::var jsonEffects = response["effects"];
+    if (!jsonEffects.isArray())
+        return false;
+
+    chain.stages.clear();
+    parseEffects(jsonEffects, chain.stages, 0);
+    return true;
+}
+
+juce::var ChainDescription::toJSON() const
+{
+    auto *response = new juce::DynamicObject();
+    response->setProperty("effects", effectsToJSON(stages));
+    return juce::var(response);
+}
+
+//==============================================================================
+void ChainDescription::writeBinary(juce::OutputStream &output) const
+{
+    output.writeString(prompt);
+    writeStages(output, stages);
+}
+
+bool ChainDescription::readBinary(juce::InputStream &input, ChainDescription &chain)
+{
+    chain.prompt = input.readString();
+    return readStages(input, chain.stages, 0);
+}
@@ -0,0 +1,123 @@
+/*
+  ==============================================================================
+
+    Plain-data description of an effect chain, as returned by the parameter
+    server. Parsed off the message thread and handed to the processor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+enum class StageType : juce::uint8
+{
+  peakFilter,
+  lowShelfFilter,
+  highShelfFilter,
+  reverb,
+  compressor,
+  delayLine,
+  phaser,
+  chorus,
+  parallel,
+  convolutionReverb
+};
+
+struct BranchDescription;
+
+//==============================================================================
+/**
+    One effect in the chain. Parameters are stored in the order the server's
+    JSON keys are listed for the stage type (see getParameterId()).
+
+    A parallel stage has no parameters; it feeds its input to every branch
+    and sums their outputs, each scaled by the branch's gain.
+
+    A convolution reverb's room is named in JSON and stored as its index in
+    ImpulseResponseCache's built-in list.
+
+    A reverb has one more parameter than the server sends, at
+    reverbDryTrimIndex: a gain in dB applied to its dry signal, 0 unless set
+    by withIdentityParameters(). juce::Reverb doubles its dry level, so a
+    reverb with no wet signal is only an identity with the trim at -6 dB.
+ */
+struct StageDescription
+{
+  static constexpr int maxParameters = 5;
+  static constexpr int reverbDryTrimIndex = 4;
+
+  StageType type = StageType::peakFilter;
+  std::array<float, maxParameters> parameters{};
+
+  // Parallel stages only. Never modified once built, so copying a stage
+  // shares it instead of allocating.
+  std::shared_ptr<const std::vector<BranchDescription>> branches;
+
+  //==============================================================================
+  static const char *getTypeName(StageType type);
+  static bool parseTypeName(const juce::String &name, StageType &type);
+  static int getNumParameters(StageType type);
+  static bool isFilter(StageType type);
+  static const char *getParameterId(StageType type, int index);
+
+  /** True for parameters that should be interpolated on a log scale. */
+  static bool isLogarithmic(StageType type, int index);
+
+  /** The same stage with its parameters set so that it leaves the signal unchanged. */
+  StageDescription withIdentityParameters() const;
+
+  /**
+      How long the stage keeps producing output after its input falls silent,
+      until it has decayed by about 60 dB. An estimate from the parameters,
+      erring on the long side.
+   */
+  double getTailLengthSeconds(double sampleRate) const;
+
+  /**
+      True if a morph can move one stage's parameters into the other's: the
+      same type and, for convolution, the same room.
+   */
+  static bool canMorphBetween(const StageDescription &a, const StageDescription &b);
+
+  /** Interpolates between two stages of the same type. Never allocates. */
+  static StageDescription interpolate(const StageDescription &a, const StageDescription &b, float amount) noexcept;
+};
+
+//==============================================================================
+/** One path through a parallel stage. A branch with no stages is the dry signal. */
+struct BranchDescription
+{
+  float gain = 1.0f; // linear
+  std::vector<StageDescription> stages;
+};
+
+//==============================================================================
+/**
+ */
+struct ChainDescription
+{
+  juce::String prompt;
+  std::vector<StageDescription> stages;
+
+  /**
+      Parses a /get-params response. Returns false if it has no effects array.
+      A parallel effect lists its branches as {"gain": ..., "effects": [...]}.
+   */
+  static bool fromJSON(const juce::var &response, ChainDescription &chain);
+
+  /** The inverse of fromJSON(), in the same schema the server uses. */
+  juce::var toJSON() const;
+
+  /**
+      Compact binary form for plugin state: the prompt, then each stage's type
+      and parameters. A parallel stage is followed by its branches' gains and
+      stages.
+   */
+  void writeBinary(juce::OutputStream &output) const;
+
+  /** Returns false if the data is truncated or names an unknown stage type. */
+  static bool readBinary(juce::InputStream &input, ChainDescription &chain);
+};
@@ -0,0 +1,286 @@
+/*
+  ==============================================================================
+
+    Rewrites a parsed chain into a cheaper one that sounds the same, before
+    any stage is built.
+
+  ==============================================================================
+*/
+
+#include "ChainOptimiser.h"
+#include "BiquadDesign.h"
+
+namespace
+{
+    using Stages = std::vector<StageDescription>;
+
+    // Merges are checked on a log grid across the audible range
+    constexpr double referenceSampleRate = 48000.0;
+    constexpr int numProbeFrequencies = 48;
+
+    bool isUnity(float gain)
+    {
+        return std::abs(gain - 1.0f) < 1.0e-6f;
+    }
+
+    bool nearlyEqual(float a, float b)
+    {
+        return std::abs(a - b) <= ChainOptimiser::parameterTolerance * juce::jmax(std::abs(a), std::abs(b));
+    }
+
+    void getResponseDecibels(StageType type, float frequency, float Q, float gainDecibels,
+                             std::array<double, numProbeFrequencies> &response)
+    {
+        BiquadCascade::Coefficients c;
+        BiquadDesign::design(type, referenceSampleRate, frequency, Q, gainDecibels, c);
+
+        for (int i = 0; i < numProbeFrequencies; ++i)
+        {
+            auto probe = 20.0 * std::pow(1000.0, i / (numProbeFrequencies - 1.0));
+            auto omega = juce::MathConstants<double>::twoPi * probe / referenceSampleRate;
+            auto cos1 = std::cos(omega), cos2 = std::cos(2.0 * omega);
+            auto sin1 = std::sin(omega), sin2 = std::sin(2.0 * omega);
+
+            auto numerator = std::hypot(c.b0 + c.b1 * cos1 + c.b2 * cos2, c.b1 * sin1 + c.b2 * sin2);
+            auto denominator = std::hypot(1.0 + c.a1 * cos1 + c.a2 * cos2, c.a1 * sin1 + c.a2 * sin2);
+            response[(size_t)i] = 20.0 * std::log10(juce::jmax(numerator / juce::jmax(denominator, 1.0e-12), 1.0e-12));
+        }
+    }
+
+    void optimiseStages(Stages &stages);
+
+    //==============================================================================
+    void flattenParallel(const StageDescription &stage, Stages &result)
+    {
+        std::vector<BranchDescription> branches;
+        auto dryGain = 0.0f;
+
+        for (auto branch : *stage.branches)
+        {
+            if (branch.gain == 0.0f)
+                continue;
+
+            optimiseStages(branch.stages);
+
+            // A gain at the end of a branch belongs in the branch gain
+            auto gain = 1.0f;
+            while (!branch.stages.empty() && ChainOptimiser::getStaticGain(branch.stages.back(), gain))
+            {
+                branch.gain *= gain;
+                branch.stages.pop_back();
+            }
+
+            if (branch.gain == 0.0f)
+                continue;
+
+            if (branch.stages.empty())
+                dryGain += branch.gain;
+            else
+                branches.push_back(std::move(branch));
+        }
+
+        if (dryGain != 0.0f)
+            branches.push_back({dryGain, {}});
+
+        if (branches.empty())
+        {
+            result.push_back(ChainOptimiser::makeGainStage(0.0f));
+            return;
+        }
+
+        // One path is just its stages followed by its gain
+        if (branches.size() == 1)
+        {
+            auto &branch = branches.front();
+            result.insert(result.end(), branch.stages.begin(), branch.stages.end());
+            result.push_back(ChainOptimiser::makeGainStage(branch.gain));
+            return;
+        }
+
+        auto flattened = stage;
+        flattened.branches = std::make_shared<const std::vector<BranchDescription>>(std::move(branches));
+        result.push_back(flattened);
+    }
+
+    void foldGains(Stages &stages)
+    {
+        Stages folded;
+        folded.reserve(stages.size());
+        auto pendingGain = 1.0f;
+
+        auto flush = [&folded, &pendingGain]
+        {
+            if (isUnity(pendingGain))
+                return;
+
+            // Scaling the sum of the branches is the same as scaling each one
+            if (!folded.empty() && folded.back().type == StageType::parallel)
+            {
+                auto branches = *folded.back().branches;
+                for (auto &branch : branches)
+                    branch.gain *= pendingGain;
+
+                folded.back().branches = std::make_shared<const std::vector<BranchDescription>>(std::move(branches));
+            }
+            else
+            {
+                folded.push_back(ChainOptimiser::makeGainStage(pendingGain));
+            }
+
+            pendingGain = 1.0f;
+        };
+
+        for (auto &stage : stages)
+        {
+            auto gain = 1.0f;
+            if (ChainOptimiser::getStaticGain(stage, gain))
+            {
+                pendingGain *= gain;
+                continue;
+            }
+
+            flush();
+            folded.push_back(stage);
+        }
+
+        flush();
+        stages = std::move(folded);
+    }
+
+    void mergeFilters(Stages &stages)
+    {
+        for (size_t i = 0; i < stages.size(); ++i)
+        {
+            if (!StageDescription::isFilter(stages[i].type))
+                continue;
+
+            for (auto j = i + 1; j < stages.size() && StageDescription::isFilter(stages[j].type);)
+            {
+                if (ChainOptimiser::canMerge(stages[i], stages[j]))
+                {
+                    stages[i].parameters[2] += stages[j].parameters[2];
+                    stages.erase(stages.begin() + (std::ptrdiff_t)j);
+                }
+                else
+                {
+                    ++j;
+                }
+            }
+        }
+    }
+
+    void optimiseStages(Stages &stages)
+    {
+        Stages flattened;
+        flattened.reserve(stages.size());
+
+        for (auto &stage : stages)
+        {
+            if (stage.type == StageType::parallel)
+                flattenParallel(stage, flattened);
+            else
+                flattened.push_back(stage);
+        }
+
+        // Merging can cancel filters out, which may leave two gains next to each other
+        foldGains(flattened);
+        mergeFilters(flattened);
+        foldGains(flattened);
+
+        stages = std::move(flattened);
+    }
+}
+
+//==============================================================================
+ChainOptimiser::Report ChainOptimiser::optimise(ChainDescription &chain)
+{
+    Report report;
+    report.numStagesBefore = countStages(chain.stages);
+
+    optimiseStages(chain.stages);
+
+    report.numStagesAfter = countStages(chain.stages);
+    return report;
+}
+
+bool ChainOptimiser::getStaticGain(const StageDescription &stage, float &gain)
+{
+    auto &p = stage.parameters;
+    gain = 1.0f;
+
+    switch (stage.type)
+    {
+    case StageType::peakFilter:
+    case StageType::lowShelfFilter:
+    case StageType::highShelfFilter:
+        return std::abs(p[2]) <= identityDecibels;
+    case StageType::reverb:
+        // Its dry level is 1 - wetLevel, trimmed
+        gain = reverbDryScale * juce::Decibels::decibelsToGain(p[StageDescription::reverbDryTrimIndex]);
+        return p[2] == 0.0f;
+    case StageType::compressor:
+        return p[1] == 1.0f;
+    case StageType::delayLine:
+        return p[0] <= 0.0f;
+    case StageType::phaser:
+    case StageType::chorus:
+        return p[4] <= 0.0f;
+    case StageType::convolutionReverb:
+        return p[1] <= 0.0f;
+    case StageType::parallel:
+    {
+        gain = 0.0f;
+        for (auto &branch : *stage.branches)
+        {
+            if (!branch.stages.empty())
+                return false;
+
+            gain += branch.gain;
+        }
+        return true;
+    }
+    }
+
+    return false;
+}
+
+bool ChainOptimiser::canMerge(const StageDescription &a, const StageDescription &b)
+{
+    if (a.type != b.type || !StageDescription::isFilter(a.type)
+        || !nearlyEqual(a.parameters[0], b.parameters[0]) || !nearlyEqual(a.parameters[1], b.parameters[1]))
+        return false;
+
+    // Exact at the centre frequency and when the gains cancel; elsewhere the
+    // bandwidth of the pair and of the merged section drift apart as the
+    // gains grow, especially for resonant shelves
+    std::array<double, numProbeFrequencies> first, second, merged;
+    getResponseDecibels(a.type, a.parameters[0], a.parameters[1], a.parameters[2], first);
+    getResponseDecibels(a.type, a.parameters[0], a.parameters[1], b.parameters[2], second);
+    getResponseDecibels(a.type, a.parameters[0], a.parameters[1], a.parameters[2] + b.parameters[2], merged);
+
+    for (int i = 0; i < numProbeFrequencies; ++i)
+        if (std::abs(first[(size_t)i] + second[(size_t)i] - merged[(size_t)i]) > maxMergeErrorDecibels)
+            return false;
+
+    return true;
+}
+
+StageDescription ChainOptimiser::makeGainStage(float gain)
+{
+    StageDescription stage;
+    stage.type = StageType::parallel;
+    stage.branches = std::make_shared<const std::vector<BranchDescription>>(1, BranchDescription{gain, {}});
+    return stage;
+}
+
+int ChainOptimiser::countStages(const std::vector<StageDescription> &stages)
+{
+    auto count = static_cast<int>(stages.size());
+
+    for (auto &stage : stages)
+        if (stage.branches != nullptr)
+            for (auto &branch : *stage.branches)
+                count += countStages(branch.stages);
+
+    return count;
+}
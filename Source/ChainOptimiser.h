@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    Rewrites a parsed chain into a cheaper one that sounds the same, before
+    any stage is built.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChainDescription.h"
+
+//==============================================================================
+/**
+    The server often returns stages that do nothing: 0 dB filters, reverbs and
+    convolutions with no wet signal, chorus and phaser at zero mix, unity-ratio
+    compressors. optimise() makes three passes, recursing into parallel
+    branches first:
+
+    - Parallel stages lose their silent branches and have their dry branches
+      merged into one. A single remaining branch is replaced by its stages.
+    - Stages that are no more than a fixed gain are removed, and consecutive
+      gains multiplied together. A gain other than one is folded into the
+      branch gains of a parallel stage right before it, or else kept as a
+      parallel stage with a single dry branch, which costs one multiply.
+    - Filters of the same type, frequency and Q within a run of filters are
+      merged by adding their gains, where the merged section stays within
+      maxMergeErrorDecibels of the pair. Filters commute, so they don't have
+      to be adjacent. Equal and opposite gains cancel exactly.
+
+    juce::Reverb scales its dry level by two, so a reverb with no wet signal
+    is a 6 dB gain rather than nothing, and is folded as one.
+ */
+struct ChainOptimiser
+{
+  /** Stages are counted including those inside parallel branches. */
+  struct Report
+  {
+    int numStagesBefore = 0, numStagesAfter = 0;
+
+    int getNumEliminated() const { return numStagesBefore - numStagesAfter; }
+  };
+
+  static Report optimise(ChainDescription &chain);
+
+  /** True if the stage only scales the signal, with the scale factor in gain. */
+  static bool getStaticGain(const StageDescription &stage, float &gain);
+
+  /** True if two filters can be replaced by one with the sum of their gains. */
+  static bool canMerge(const StageDescription &a, const StageDescription &b);
+
+  /** A parallel stage with a single dry branch. */
+  static StageDescription makeGainStage(float gain);
+
+  static int countStages(const std::vector<StageDescription> &stages);
+
+  //==============================================================================
+  static constexpr float identityDecibels = 0.01f;
+  static constexpr float maxMergeErrorDecibels = 0.25f;
+  static constexpr float parameterTolerance = 1.0e-3f; // relative, for frequency and Q
+  static constexpr float reverbDryScale = 2.0f;        // juce::Reverb's internal dry scale factor
+};
@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    Garbage queue for effect chains that have been swapped out. Chains are
+    destroyed on a background thread once the audio thread is done with them.
+
+  ==============================================================================
+*/
+
+#include "ChainReclaimer.h"
+#include "RealtimeWatchdog.h"
+
+//==============================================================================
+ChainReclaimer::ChainReclaimer()
+    : juce::Thread("SemanticEQ chain reclaimer")
+{
+    startThread();
+}
+
+ChainReclaimer::~ChainReclaimer()
+{
+    stopThread(pollIntervalMs * 10);
+
+    // The owning processor is being destroyed, so no block can be running
+    collect();
+}
+
+//==============================================================================
+bool ChainReclaimer::retireFromAudioThread(EffectChain *chain)
+{
+    if (chain == nullptr)
+        return true;
+
+    const auto scope = fifo.write(1);
+    if (scope.blockSize1 + scope.blockSize2 == 0)
+        return false;
+
+    queue[(size_t)(scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2)] = chain;
+    return true;
+}
+
+void ChainReclaimer::retire(std::unique_ptr<EffectChain> chain)
+{
+    if (chain == nullptr)
+        return;
+
+    SEMANTICEQ_RT_NOTE_LOCK("ChainReclaimer::lock");
+    const juce::ScopedLock sl(lock);
+    pending.push_back(std::move(chain));
+}
+
+int ChainReclaimer::getNumPending() const
+{
+    const juce::ScopedLock sl(lock);
+    return static_cast<int>(pending.size()) + fifo.getNumReady();
+}
+
+//==============================================================================
+void ChainReclaimer::run()
+{
+    while (!threadShouldExit())
+    {
+        collect();
+        wait(pollIntervalMs);
+    }
+}
+
+void ChainReclaimer::collect()
+{
+    std::vector<std::unique_ptr<EffectChain>> released;
+    {
+        const juce::ScopedLock sl(lock);
+        released.swap(pending);
+    }
+
+    {
+        const auto scope = fifo.read(fifo.getNumReady());
+        scope.forEach([this, &released](int index)
+                      { released.emplace_back(queue[(size_t)index]); });
+    }
+
+    // Destroy outside the lock so retire() never waits for a chain to be
+    // torn down
+    released.clear();
+}
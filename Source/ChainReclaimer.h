@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+
+    Garbage queue for effect chains that have been swapped out. Chains are
+    destroyed on a background thread once the audio thread is done with them.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "EffectChain.h"
+
+//==============================================================================
+/**
+    The audio thread owns the chains it is rendering and hands each one back
+    through a lock-free single-producer queue once it has stopped using it.
+    Chains that never reached the audio thread can be retired from any other
+    thread. Either way they are destroyed on the reclaimer thread.
+ */
+class ChainReclaimer : private juce::Thread
+{
+public:
+  ChainReclaimer();
+  ~ChainReclaimer() override;
+
+  //==============================================================================
+  /** Audio thread only. Never blocks or allocates; returns false if the queue is full. */
+  bool retireFromAudioThread(EffectChain *chain);
+
+  /** Space left in the audio thread's queue. */
+  int getFreeSpace() const { return fifo.getFreeSpace(); }
+
+  /** For chains the audio thread can no longer reach. */
+  void retire(std::unique_ptr<EffectChain> chain);
+
+  int getNumPending() const;
+
+  //==============================================================================
+  static constexpr int pollIntervalMs = 50;
+  static constexpr int queueSize = 64;
+
+private:
+  //==============================================================================
+  void run() override;
+  void collect();
+
+  //==============================================================================
+  juce::AbstractFifo fifo{queueSize};
+  std::array<EffectChain *, queueSize> queue{};
+
+  juce::CriticalSection lock;
+  std::vector<std::unique_ptr<EffectChain>> pending;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChainReclaimer)
+};
@@ -0,0 +1,381 @@
+/*
+  ==============================================================================
+
+    Concrete DSP stages used by the compiled effect chain. Each stage wraps a
+    juce::dsp processor directly, with no AudioProcessor or graph around it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "BiquadCascade.h"
+#include "BiquadDesign.h"
+#include "ChainDescription.h"
+#include "LinearPhaseFilter.h"
+#include "PartitionedConvolver.h"
+#include "ParallelStage.h"
+
+//==============================================================================
+/**
+    Every stage is default constructible and takes its parameters through
+    setParameters(), so a chain can construct its stages in place. Once a
+    stage is prepared, setParameters() is safe to call from the audio thread.
+
+    A run of adjacent peak/shelf filters is compiled into one
+    FilterCascadeStage, which runs them as sections of a single kernel, or
+    in linear-phase mode into one LinearPhaseFilterStage (see
+    LinearPhaseFilter.h).
+    Parallel stages hold nested chains; see ParallelStage.h.
+ */
+class FilterCascadeStage
+{
+public:
+  void setParameters(const StageDescription *firstSection, int numSections)
+  {
+    sections.assign(firstSection, firstSection + numSections);
+
+    if (sampleRate > 0.0)
+      updateCoefficients();
+  }
+
+  /** Safe on the audio thread: designs in place rather than through the shared cache. */
+  void setSection(int index, const StageDescription &section)
+  {
+    sections[(size_t)index] = section;
+
+    BiquadCascade::Coefficients coefficients;
+    auto &p = section.parameters;
+    BiquadDesign::design(section.type, sampleRate, p[0], p[1], p[2], coefficients);
+    cascade.setCoefficients(index, coefficients);
+  }
+
+  void prepare(const juce::dsp::ProcessSpec &spec)
+  {
+    sampleRate = spec.sampleRate;
+    cascade.prepare(static_cast<int>(spec.numChannels), static_cast<int>(spec.maximumBlockSize), static_cast<int>(sections.size()));
+    updateCoefficients();
+  }
+
+  void process(const juce::dsp::ProcessContextReplacing<float> &context)
+  {
+    cascade.process(context.getOutputBlock());
+  }
+
+  void reset()
+  {
+    cascade.reset();
+  }
+
+private:
+  void updateCoefficients()
+  {
+    BiquadCascade::Coefficients coefficients;
+
+    for (size_t i = 0; i < sections.size(); ++i)
+    {
+      auto &p = sections[i].parameters;
+      coefficientCache->getCoefficients(sections[i].type, sampleRate, p[0], p[1], p[2], coefficients);
+      cascade.setCoefficients(static_cast<int>(i), coefficients);
+    }
+  }
+
+  std::vector<StageDescription> sections;
+  BiquadCascade cascade;
+  juce::SharedResourcePointer<CoefficientCache> coefficientCache;
+  double sampleRate = 0.0;
+};
+
+/**
+    juce::dsp::Reverb is mono or stereo. Channels are paired by their role in
+    the layout (left/right, the surround and height pairs, ...) and every
+    pair gets a stereo reverb; any other channel, such as a centre or an
+    ambisonic component, gets a mono one, so no two unrelated channels are
+    mixed. LFE channels get only the dry level.
+ */
+class ReverbStage
+{
+public:
+  void setParameters(const StageDescription &stage)
+  {
+    reverbParams.roomSize = stage.parameters[0];
+    reverbParams.damping = stage.parameters[1];
+    reverbParams.wetLevel = stage.parameters[2];
+    reverbParams.dryLevel = (1 - stage.parameters[2]) * juce::Decibels::decibelsToGain(stage.parameters[StageDescription::reverbDryTrimIndex]);
+    reverbParams.width = stage.parameters[3];
+    dryGain = reverbParams.dryLevel * dryScaleFactor;
+
+    for (size_t i = 0; i < groups.size(); ++i)
+      reverbs[i].setParameters(reverbParams);
+  }
+
+  /** Call before prepare(); a layout that doesn't match the spec is ignored. */
+  void setChannelLayout(const juce::AudioChannelSet &layout)
+  {
+    channelLayout = layout;
+  }
+
+  void prepare(const juce::dsp::ProcessSpec &spec)
+  {
+    auto numChannels = static_cast<int>(spec.numChannels);
+    auto layout = channelLayout.size() == numChannels ? channelLayout : juce::AudioChannelSet::canonicalChannelSet(numChannels);
+
+    std::vector<ChannelGroup> newGroups;
+    dryChannels.clear();
+    groupChannels(layout, newGroups, dryChannels);
+
+    // Kept across re-preparation; setSampleRate() only resizes the combs when the rate changes
+    if (reverbs == nullptr || newGroups != groups)
+    {
+      groups = std::move(newGroups);
+      reverbs = std::make_unique<juce::dsp::Reverb[]>(groups.size());
+    }
+
+    for (size_t i = 0; i < groups.size(); ++i)
+    {
+      reverbs[i].setParameters(reverbParams);
+      reverbs[i].prepare({spec.sampleRate, spec.maximumBlockSize, static_cast<juce::uint32>(groups[i].getNumChannels())});
+    }
+
+    lastDryGain = dryGain;
+  }
+
+  void process(const juce::dsp::ProcessContextReplacing<float> &context)
+  {
+    auto &block = context.getOutputBlock();
+    auto numSamples = block.getNumSamples();
+
+    for (size_t i = 0; i < groups.size(); ++i)
+    {
+      auto &group = groups[i];
+      float *channels[] = {block.getChannelPointer((size_t)group.first),
+                           group.second >= 0 ? block.getChannelPointer((size_t)group.second) : nullptr};
+
+      juce::dsp::AudioBlock<float> groupBlock(channels, (size_t)group.getNumChannels(), numSamples);
+      reverbs[i].process(juce::dsp::ProcessContextReplacing<float>(groupBlock));
+    }
+
+    // The reverbs ramp their dry level, so the dry channels do too
+    for (auto channel : dryChannels)
+    {
+      auto *samples = block.getChannelPointer((size_t)channel);
+
+      if (lastDryGain == dryGain)
+      {
+        juce::FloatVectorOperations::multiply(samples, dryGain, static_cast<int>(numSamples));
+        continue;
+      }
+
+      auto step = (dryGain - lastDryGain) / static_cast<float>(numSamples);
+      for (size_t i = 0; i < numSamples; ++i)
+        samples[i] *= lastDryGain + step * static_cast<float>(i);
+    }
+
+    lastDryGain = dryGain;
+  }
+
+  void reset()
+  {
+    for (size_t i = 0; i < groups.size(); ++i)
+      reverbs[i].reset();
+
+    lastDryGain = dryGain;
+  }
+
+private:
+  /** The channels one reverb runs on; second is -1 for a mono reverb. */
+  struct ChannelGroup
+  {
+    int first = -1, second = -1;
+
+    int getNumChannels() const { return second >= 0 ? 2 : 1; }
+    bool operator==(const ChannelGroup &other) const { return first == other.first && second == other.second; }
+    bool operator!=(const ChannelGroup &other) const { return !operator==(other); }
+  };
+
+  static void groupChannels(const juce::AudioChannelSet &layout, std::vector<ChannelGroup> &groups, std::vector<int> &dry)
+  {
+    using Type = juce::AudioChannelSet::ChannelType;
+
+    static constexpr std::pair<Type, Type> pairs[] = {
+        {Type::left, Type::right},
+        {Type::leftCentre, Type::rightCentre},
+        {Type::wideLeft, Type::wideRight},
+        {Type::leftSurround, Type::rightSurround},
+        {Type::leftSurroundSide, Type::rightSurroundSide},
+        {Type::leftSurroundRear, Type::rightSurroundRear},
+        {Type::topFrontLeft, Type::topFrontRight},
+        {Type::topSideLeft, Type::topSideRight},
+        {Type::topRearLeft, Type::topRearRight},
+        {Type::bottomFrontLeft, Type::bottomFrontRight},
+        {Type::bottomSideLeft, Type::bottomSideRight},
+        {Type::bottomRearLeft, Type::bottomRearRight},
+        {Type::proximityLeft, Type::proximityRight}};
+
+    std::vector<bool> grouped((size_t)layout.size(), false);
+
+    for (auto &pair : pairs)
+    {
+      auto first = layout.getChannelIndexForType(pair.first);
+      auto second = layout.getChannelIndexForType(pair.second);
+
+      if (first >= 0 && second >= 0)
+      {
+        groups.push_back({first, second});
+        grouped[(size_t)first] = grouped[(size_t)second] = true;
+      }
+    }
+
+    for (int channel = 0; channel < layout.size(); ++channel)
+    {
+      if (grouped[(size_t)channel])
+        continue;
+
+      auto type = layout.getTypeOfChannel(channel);
+      if (type == Type::LFE || type == Type::LFE2)
+        dry.push_back(channel);
+      else
+        groups.push_back({channel, -1});
+    }
+  }
+
+  static constexpr float dryScaleFactor = 2.0f; // juce::Reverb's, so dry channels match the reverberated ones
+
+  juce::dsp::Reverb::Parameters reverbParams;
+  juce::AudioChannelSet channelLayout;
+  std::vector<ChannelGroup> groups;
+  std::vector<int> dryChannels;
+  std::unique_ptr<juce::dsp::Reverb[]> reverbs;
+  float dryGain = 1.0f, lastDryGain = 1.0f;
+};
+
+/** Convolution with one of the built-in rooms. The room is fixed once prepared. */
+class ConvolutionReverbStage
+{
+public:
+  void setParameters(const StageDescription &stage)
+  {
+    room = juce::jlimit(0, ImpulseResponseCache::getNumImpulseResponses() - 1, static_cast<int>(stage.parameters[0]));
+    wetLevel = juce::jlimit(0.0f, 1.0f, stage.parameters[1]);
+  }
+
+  void prepare(const juce::dsp::ProcessSpec &spec)
+  {
+    impulseResponse = impulseResponses->get(room, spec.sampleRate, partitionSize);
+    convolver.prepare(*impulseResponse, static_cast<int>(spec.numChannels));
+  }
+
+  void process(const juce::dsp::ProcessContextReplacing<float> &context)
+  {
+    convolver.process(context.getOutputBlock(), 1.0f - wetLevel, wetLevel);
+  }
+
+  void reset() { convolver.reset(); }
+
+  static constexpr int partitionSize = 256;
+
+private:
+  PartitionedConvolver convolver;
+  juce::SharedResourcePointer<ImpulseResponseCache> impulseResponses;
+  std::shared_ptr<const PartitionedImpulseResponse> impulseResponse;
+  int room = 0;
+  float wetLevel = 0.0f;
+};
+
+class CompressorStage
+{
+public:
+  void setParameters(const StageDescription &stage)
+  {
+    compressor.setThreshold(stage.parameters[0]);
+    compressor.setRatio(stage.parameters[1]);
+    compressor.setAttack(stage.parameters[2]);
+    compressor.setRelease(stage.parameters[3]);
+  }
+
+  void prepare(const juce::dsp::ProcessSpec &spec) { compressor.prepare(spec); }
+  void process(const juce::dsp::ProcessContextReplacing<float> &context) { compressor.process(context); }
+  void reset() { compressor.reset(); }
+
+private:
+  juce::dsp::Compressor<float> compressor;
+};
+
+class DelayLineStage
+{
+public:
+  void setParameters(const StageDescription &stage)
+  {
+    delayTime = stage.parameters[0];
+    maximumDelayInSamples = stage.parameters[1];
+
+    // The buffer size only changes in prepare(); later updates move the delay within it
+    if (isPrepared)
+      updateDelay();
+  }
+
+  void prepare(const juce::dsp::ProcessSpec &spec)
+  {
+    delayLine.setMaximumDelayInSamples(juce::jmax(0, static_cast<int>(maximumDelayInSamples)));
+    delayLine.prepare(spec);
+    updateDelay();
+    isPrepared = true;
+  }
+
+  void process(const juce::dsp::ProcessContextReplacing<float> &context) { delayLine.process(context); }
+  void reset() { delayLine.reset(); }
+
+private:
+  void updateDelay()
+  {
+    delayLine.setDelay(juce::jlimit(0.0f, static_cast<float>(delayLine.getMaximumDelayInSamples()), delayTime));
+  }
+
+  juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::Linear> delayLine;
+  float delayTime = 0.0f, maximumDelayInSamples = 0.0f;
+  bool isPrepared = false;
+};
+
+class PhaserStage
+{
+public:
+  void setParameters(const StageDescription &stage)
+  {
+    phaser.setRate(stage.parameters[0]);
+    phaser.setDepth(stage.parameters[1]);
+    phaser.setCentreFrequency(stage.parameters[2]);
+    phaser.setFeedback(stage.parameters[3]);
+    phaser.setMix(stage.parameters[4]);
+  }
+
+  void prepare(const juce::dsp::ProcessSpec &spec) { phaser.prepare(spec); }
+  void process(const juce::dsp::ProcessContextReplacing<float> &context) { phaser.process(context); }
+  void reset() { phaser.reset(); }
+
+private:
+  juce::dsp::Phaser<float> phaser;
+};
+
+class ChorusStage
+{
+public:
+  void setParameters(const StageDescription &stage)
+  {
+    chorus.setRate(stage.parameters[0]);
+    chorus.setDepth(stage.parameters[1]);
+    chorus.setCentreDelay(stage.parameters[2]);
+    chorus.setFeedback(stage.parameters[3]);
+    chorus.setMix(stage.parameters[4]);
+  }
+
+  void prepare(const juce::dsp::ProcessSpec &spec) { chorus.prepare(spec); }
+  void process(const juce::dsp::ProcessContextReplacing<float> &context) { chorus.process(context); }
+  void reset() { chorus.reset(); }
+
+private:
+  juce::dsp::Chorus<float> chorus;
+};
+
+//==============================================================================
+using ChainStage = std::variant<FilterCascadeStage, ReverbStage, CompressorStage, DelayLineStage, PhaserStage, ChorusStage, ParallelStage, ConvolutionReverbStage, LinearPhaseFilterStage>;
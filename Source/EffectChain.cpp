@@ -0,0 +1,508 @@
+/*
+  ==============================================================================
+
+    A fully built and prepared effect chain. The structure of a chain never
+    changes once constructed, so one can be published to the audio thread as
+    a whole.
+
+  ==============================================================================
+*/
+
+#include "EffectChain.h"
+#include "RealtimeWatchdog.h"
+
+namespace
+{
+    juce::uint32 makeChainId()
+    {
+        static std::atomic<juce::uint32> lastId{0};
+        return ++lastId;
+    }
+
+    bool isSameStage(const StageDescription &a, const StageDescription &b)
+    {
+        if (a.type != b.type || a.parameters != b.parameters)
+            return false;
+
+        if (a.branches == b.branches)
+            return true;
+
+        if (a.branches == nullptr || b.branches == nullptr || a.branches->size() != b.branches->size())
+            return false;
+
+        for (size_t i = 0; i < a.branches->size(); ++i)
+        {
+            auto &branchA = (*a.branches)[i];
+            auto &branchB = (*b.branches)[i];
+
+            if (branchA.gain != branchB.gain || branchA.stages.size() != branchB.stages.size()
+                || !std::equal(branchA.stages.begin(), branchA.stages.end(), branchB.stages.begin(), isSameStage))
+                return false;
+        }
+
+        return true;
+    }
+}
+
+//==============================================================================
+EffectChain::EffectChain(const ChainDescription &descriptionIn, const juce::dsp::ProcessSpec &spec, FilterMode filterMode,
+                         const juce::AudioChannelSet &channelLayout)
+    : description(descriptionIn),
+      id(makeChainId()),
+      stagesA(descriptionIn.stages),
+      stagesB(descriptionIn.stages)
+{
+    build(0.0f, spec, filterMode, channelLayout);
+}
+
+EffectChain::EffectChain(const ChainDescription &descriptionA, const ChainDescription &descriptionB,
+                         float initialMorph, const juce::dsp::ProcessSpec &spec, FilterMode filterMode,
+                         const juce::AudioChannelSet &channelLayout)
+    : description(descriptionA),
+      morphTarget(descriptionB),
+      morphable(true),
+      id(makeChainId())
+{
+    alignForMorph(descriptionA, descriptionB, stagesA, stagesB);
+    build(initialMorph, spec, filterMode, channelLayout);
+}
+
+void EffectChain::build(float initialMorph, const juce::dsp::ProcessSpec &spec, FilterMode filterModeIn,
+                        const juce::AudioChannelSet &channelLayout)
+{
+    filterMode = filterModeIn;
+
+    morph.setCurrentAndTargetValue(initialMorph);
+    updateRamp.setCurrentAndTargetValue(1.0f);
+
+    workingStages.resize(stagesA.size());
+    for (size_t i = 0; i < stagesA.size(); ++i)
+        workingStages[i] = StageDescription::interpolate(stagesA[i], stagesB[i], initialMorph);
+
+    updateStart.resize(stagesA.size());
+
+    for (size_t i = 0; i < workingStages.size(); i += (size_t)getFilterRunLength(workingStages, i))
+        stageRanges.push_back({i, getFilterRunLength(workingStages, i)});
+
+    numStages = static_cast<int>(stageRanges.size());
+    auto linearPhase = filterMode == FilterMode::linearPhase;
+    activity.resize((size_t)numStages);
+
+    // Stages are built in place: the juce::dsp processors they wrap can't be moved
+    stages = std::make_unique<ChainStage[]>((size_t)numStages);
+
+    for (int i = 0; i < numStages; ++i)
+    {
+        auto &stage = stages[(size_t)i];
+        auto &range = stageRanges[(size_t)i];
+
+        if (linearPhase && StageDescription::isFilter(workingStages[range.first].type))
+            stage.emplace<LinearPhaseFilterStage>().setParameters(&workingStages[range.first], range.length);
+        else if (StageDescription::isFilter(workingStages[range.first].type))
+            stage.emplace<FilterCascadeStage>().setParameters(&workingStages[range.first], range.length);
+        else if (workingStages[range.first].type == StageType::parallel)
+            stage.emplace<ParallelStage>().setBranches(stagesA[range.first], stagesB[range.first], initialMorph);
+        else
+            initialiseStage(stage, workingStages[range.first]);
+    }
+
+    prepare(spec, channelLayout);
+}
+
+void EffectChain::prepare(const juce::dsp::ProcessSpec &spec, const juce::AudioChannelSet &channelLayout)
+{
+    // When re-preparing, anything still ramping jumps to where it was
+    // heading, so the stages are prepared with their final parameters
+    if (sampleRate > 0.0 && (morph.isSmoothing() || updateRamp.isSmoothing()))
+    {
+        morph.setCurrentAndTargetValue(morph.getTargetValue());
+        updateRamp.setCurrentAndTargetValue(1.0f);
+        applyMorph(morph.getCurrentValue());
+    }
+
+    sampleRate = spec.sampleRate;
+    morph.reset(spec.sampleRate, morphRampSeconds);
+    updateRamp.reset(spec.sampleRate, updateRampSeconds);
+
+    updateTails();
+
+    latencySamples = 0;
+    for (auto &range : stageRanges)
+        if (filterMode == FilterMode::linearPhase && StageDescription::isFilter(stagesA[range.first].type))
+            latencySamples += LinearPhaseFilterStage::getLatencySamples(spec.sampleRate);
+
+    auto numChannels = static_cast<int>(spec.numChannels);
+    auto layout = channelLayout.size() == numChannels ? channelLayout : juce::AudioChannelSet::canonicalChannelSet(numChannels);
+
+    // Each stage recomputes what depends on the spec and keeps any storage that still fits
+    for (int i = 0; i < numStages; ++i)
+        std::visit([&spec, &layout](auto &stage)
+                   {
+                       using StageClass = std::decay_t<decltype(stage)>;
+
+                       if constexpr (std::is_same_v<StageClass, ReverbStage> || std::is_same_v<StageClass, ParallelStage>)
+                           stage.setChannelLayout(layout);
+
+                       stage.prepare(spec);
+                   },
+                   stages[(size_t)i]);
+
+    for (auto &stageActivity : activity)
+    {
+        stageActivity.silentSamples = 0;
+        stageActivity.asleep = false;
+    }
+}
+
+//==============================================================================
+void EffectChain::process(juce::dsp::AudioBlock<float> &block, StageProfiler *profiler)
+{
+    SEMANTICEQ_RT_TAG("EffectChain::process");
+
+    if (profiler != nullptr)
+        profiler->startBlock(*this);
+
+    auto inputIsSilent = isSilent(block);
+
+    if (!morph.isSmoothing() && !updateRamp.isSmoothing())
+    {
+        processStages(block, profiler, inputIsSilent);
+
+        if (profiler != nullptr)
+            profiler->endBlock();
+
+        return;
+    }
+
+    // Parameters follow the smoothed morph and update at control rate, not per sample
+    auto numSamples = block.getNumSamples();
+    for (size_t start = 0; start < numSamples; start += (size_t)controlInterval)
+    {
+        auto length = juce::jmin((size_t)controlInterval, numSamples - start);
+        updateRamp.skip(static_cast<int>(length));
+        applyMorph(morph.skip(static_cast<int>(length)));
+
+        auto subBlock = block.getSubBlock(start, length);
+        processStages(subBlock, profiler, inputIsSilent);
+    }
+
+    if (profiler != nullptr)
+        profiler->endBlock();
+}
+
+void EffectChain::processStages(juce::dsp::AudioBlock<float> &block, StageProfiler *profiler, bool inputIsSilent)
+{
+    juce::dsp::ProcessContextReplacing<float> context(block);
+    auto numSamples = static_cast<juce::int64>(block.getNumSamples());
+
+    for (int i = 0; i < numStages; ++i)
+    {
+        auto &stageActivity = activity[(size_t)i];
+
+        if (!inputIsSilent)
+        {
+            // Its state decayed while it slept, so start from clean
+            if (stageActivity.asleep)
+                std::visit([](auto &stage) { stage.reset(); }, stages[(size_t)i]);
+
+            stageActivity.asleep = false;
+            stageActivity.silentSamples = 0;
+            processStage(i, context, profiler);
+            continue;
+        }
+
+        // Silence in and decayed: the near-silent input passes straight through
+        if (stageActivity.asleep)
+            continue;
+
+        processStage(i, context, profiler);
+
+        // Only measured while the input is silent, so playing audio never pays for it
+        if (isSilent(block))
+        {
+            stageActivity.silentSamples += numSamples;
+            stageActivity.asleep = stageActivity.silentSamples > stageActivity.samplesBeforeSleep;
+        }
+        else
+        {
+            stageActivity.silentSamples = 0;
+            inputIsSilent = false;
+        }
+    }
+}
+
+void EffectChain::processStage(int index, juce::dsp::ProcessContextReplacing<float> &context, StageProfiler *profiler)
+{
+    auto start = profiler != nullptr ? juce::Time::getHighResolutionTicks() : 0;
+
+    std::visit([&context](auto &stage) { stage.process(context); }, stages[(size_t)index]);
+
+    if (profiler != nullptr)
+        profiler->addStageTicks(index, juce::Time::getHighResolutionTicks() - start);
+}
+
+int EffectChain::getNumSleepingStages() const
+{
+    return static_cast<int>(std::count_if(activity.begin(), activity.end(), [](const StageActivity &a) { return a.asleep; }));
+}
+
+const char *EffectChain::getStageName(int stage) const
+{
+    if (std::holds_alternative<LinearPhaseFilterStage>(stages[(size_t)stage]))
+        return "linearPhaseFilter";
+
+    auto &range = stageRanges[(size_t)stage];
+    return StageDescription::isFilter(workingStages[range.first].type) ? "filterCascade"
+                                                                      : StageDescription::getTypeName(workingStages[range.first].type);
+}
+
+void EffectChain::reset()
+{
+    for (int i = 0; i < numStages; ++i)
+        std::visit([](auto &stage) { stage.reset(); }, stages[(size_t)i]);
+
+    for (auto &stageActivity : activity)
+    {
+        stageActivity.silentSamples = 0;
+        stageActivity.asleep = false;
+    }
+}
+
+//==============================================================================
+void EffectChain::setMorph(float newMorph)
+{
+    if (morphable && newMorph != morph.getTargetValue())
+        morph.setTargetValue(juce::jlimit(0.0f, 1.0f, newMorph));
+}
+
+void EffectChain::setMorphImmediately(float newMorph)
+{
+    if (!morphable)
+        return;
+
+    morph.setCurrentAndTargetValue(juce::jlimit(0.0f, 1.0f, newMorph));
+    applyMorph(morph.getCurrentValue());
+}
+
+void EffectChain::applyMorph(float amount)
+{
+    SEMANTICEQ_RT_TAG("EffectChain::applyMorph");
+
+    auto updateAmount = updateRamp.getCurrentValue();
+
+    for (size_t i = 0; i < workingStages.size(); ++i)
+    {
+        workingStages[i] = StageDescription::interpolate(stagesA[i], stagesB[i], amount);
+
+        if (updateAmount < 1.0f)
+            workingStages[i] = StageDescription::interpolate(updateStart[i], workingStages[i], updateAmount);
+    }
+
+    for (int i = 0; i < numStages; ++i)
+    {
+        auto &range = stageRanges[(size_t)i];
+        std::visit([this, &range, amount](auto &stage)
+                   {
+                       using StageClass = std::decay_t<decltype(stage)>;
+
+                       if constexpr (std::is_same_v<StageClass, FilterCascadeStage> || std::is_same_v<StageClass, LinearPhaseFilterStage>)
+                       {
+                           for (int section = 0; section < range.length; ++section)
+                               stage.setSection(section, workingStages[range.first + (size_t)section]);
+                       }
+                       else if constexpr (std::is_same_v<StageClass, ParallelStage>)
+                       {
+                           stage.setMorph(amount);
+                       }
+                       else
+                       {
+                           stage.setParameters(workingStages[range.first]);
+                       }
+                   },
+                   stages[(size_t)i]);
+    }
+}
+
+//==============================================================================
+void EffectChain::applyUpdate(ParameterUpdate &update) noexcept
+{
+    SEMANTICEQ_RT_TAG("EffectChain::applyUpdate");
+    jassert(update.stagesA.size() == stagesA.size() && update.startStages.size() == updateStart.size());
+
+    // Ramp from the parameters as they are now, even halfway through a morph
+    // or another update
+    std::copy(workingStages.begin(), workingStages.end(), update.startStages.begin());
+    std::swap(updateStart, update.startStages);
+
+    std::swap(description, update.description);
+    std::swap(morphTarget, update.morphTarget);
+    std::swap(stagesA, update.stagesA);
+    std::swap(stagesB, update.stagesB);
+
+    updateRamp.setCurrentAndTargetValue(0.0f);
+    updateRamp.setTargetValue(1.0f);
+
+    updateTails();
+}
+
+bool EffectChain::hasSameStructure(const std::vector<StageDescription> &a, const std::vector<StageDescription> &b)
+{
+    if (a.size() != b.size())
+        return false;
+
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        if (!StageDescription::canMorphBetween(a[i], b[i]))
+            return false;
+
+        // The delay buffer is sized in prepare(); parallel stages hold chains of their own
+        if (a[i].type == StageType::delayLine && a[i].parameters[1] != b[i].parameters[1])
+            return false;
+
+        if (a[i].type == StageType::parallel && !isSameStage(a[i], b[i]))
+            return false;
+    }
+
+    return true;
+}
+
+void EffectChain::updateTails()
+{
+    tailLengthSeconds = 0.0;
+
+    for (int i = 0; i < numStages; ++i)
+    {
+        auto stageTail = getStageTailSeconds(stagesA, stagesB, stageRanges[(size_t)i], sampleRate, filterMode);
+        activity[(size_t)i].samplesBeforeSleep = static_cast<juce::int64>((stageTail + sleepMarginSeconds) * sampleRate);
+        tailLengthSeconds += stageTail;
+    }
+}
+
+double EffectChain::computeTailLengthSeconds(const std::vector<StageDescription> &stagesA, const std::vector<StageDescription> &stagesB,
+                                             double sampleRate, FilterMode filterMode)
+{
+    auto total = 0.0;
+    for (size_t i = 0; i < stagesA.size(); i += (size_t)getFilterRunLength(stagesA, i))
+        total += getStageTailSeconds(stagesA, stagesB, {i, getFilterRunLength(stagesA, i)}, sampleRate, filterMode);
+
+    return total;
+}
+
+double EffectChain::getStageTailSeconds(const std::vector<StageDescription> &stagesA, const std::vector<StageDescription> &stagesB,
+                                        StageRange range, double sampleRate, FilterMode filterMode)
+{
+    // Tails add up in series; a morphing stage may be at either end. An FIR
+    // rings for its whole length.
+    auto stageTail = 0.0;
+    for (auto k = range.first; k < range.first + (size_t)range.length; ++k)
+        stageTail += juce::jmax(stagesA[k].getTailLengthSeconds(sampleRate), stagesB[k].getTailLengthSeconds(sampleRate));
+
+    if (filterMode == FilterMode::linearPhase && StageDescription::isFilter(stagesA[range.first].type))
+        stageTail += LinearPhaseFilterStage::getFirLength(sampleRate) / sampleRate;
+
+    return stageTail;
+}
+
+//==============================================================================
+void EffectChain::alignForMorph(const ChainDescription &a, const ChainDescription &b,
+                                std::vector<StageDescription> &alignedA, std::vector<StageDescription> &alignedB)
+{
+    auto &sa = a.stages;
+    auto &sb = b.stages;
+    auto na = sa.size(), nb = sb.size();
+
+    // Longest common subsequence of stage types: matched stages morph into each
+    // other, the rest fade in or out through their identity parameters
+    std::vector<std::vector<int>> lcs(na + 1, std::vector<int>(nb + 1, 0));
+    for (size_t i = na; i-- > 0;)
+        for (size_t j = nb; j-- > 0;)
+            lcs[i][j] = StageDescription::canMorphBetween(sa[i], sb[j]) ? lcs[i + 1][j + 1] + 1 : juce::jmax(lcs[i + 1][j], lcs[i][j + 1]);
+
+    size_t i = 0, j = 0;
+    while (i < na || j < nb)
+    {
+        if (i < na && j < nb && StageDescription::canMorphBetween(sa[i], sb[j]))
+        {
+            alignedA.push_back(sa[i++]);
+            alignedB.push_back(sb[j++]);
+        }
+        else if (j == nb || (i < na && lcs[i + 1][j] >= lcs[i][j + 1]))
+        {
+            alignedA.push_back(sa[i]);
+            alignedB.push_back(sa[i++].withIdentityParameters());
+        }
+        else
+        {
+            alignedA.push_back(sb[j].withIdentityParameters());
+            alignedB.push_back(sb[j++]);
+        }
+    }
+
+    // The delay buffer is sized once, so both ends share the larger maximum
+    for (size_t k = 0; k < alignedA.size(); ++k)
+    {
+        if (alignedA[k].type == StageType::delayLine)
+        {
+            auto maximum = juce::jmax(alignedA[k].parameters[1], alignedB[k].parameters[1]);
+            alignedA[k].parameters[1] = alignedB[k].parameters[1] = maximum;
+        }
+    }
+}
+
+int EffectChain::getFilterRunLength(const std::vector<StageDescription> &stages, size_t first)
+{
+    auto end = first;
+    while (end < stages.size() && StageDescription::isFilter(stages[end].type))
+        ++end;
+
+    return juce::jmax(1, static_cast<int>(end - first));
+}
+
+void EffectChain::initialiseStage(ChainStage &stage, const StageDescription &description)
+{
+    switch (description.type)
+    {
+    case StageType::reverb:
+        stage.emplace<ReverbStage>().setParameters(description);
+        break;
+    case StageType::compressor:
+        stage.emplace<CompressorStage>().setParameters(description);
+        break;
+    case StageType::delayLine:
+        stage.emplace<DelayLineStage>().setParameters(description);
+        break;
+    case StageType::phaser:
+        stage.emplace<PhaserStage>().setParameters(description);
+        break;
+    case StageType::chorus:
+        stage.emplace<ChorusStage>().setParameters(description);
+        break;
+    case StageType::convolutionReverb:
+        stage.emplace<ConvolutionReverbStage>().setParameters(description);
+        break;
+    default:
+        jassertfalse; // filters are compiled as cascades, parallel stages from both ends
+        break;
+    }
+}
+
+bool EffectChain::isSilent(const juce::dsp::AudioBlock<float> &block)
+{
+    for (size_t channel = 0; channel < block.getNumChannels(); ++channel)
+    {
+        auto *data = block.getChannelPointer(channel);
+        auto numSamples = static_cast<int>(block.getNumSamples());
+
+        // Written so that a NaN in the range fails the test
+        auto range = juce::FloatVectorOperations::findMinAndMax(data, numSamples);
+        if (!(range.getStart() >= -silenceThreshold && range.getEnd() <= silenceThreshold))
+            return false;
+
+        // The vectorised min and max can step over a NaN, so a block that looks
+        // silent is also checked for non-finite samples. Only quiet blocks get here.
+        if (!std::all_of(data, data + numSamples, [](float sample) { return std::isfinite(sample); }))
+            return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,196 @@
+/*
+  ==============================================================================
+
+    A fully built and prepared effect chain. The structure of a chain never
+    changes once constructed, so one can be published to the audio thread as
+    a whole; only its parameters can be updated in place, and it can be
+    prepared again for a new spec.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChainDescription.h"
+#include "ChainStages.h"
+#include "StageProfiler.h"
+
+//==============================================================================
+/**
+    Compiles a ChainDescription into a contiguous array of concrete stages and
+    prepares them for the given spec. Runs of adjacent filters become a single
+    cascade stage, so getNumStages() can be less than the description's size.
+    Construction allocates and must happen off the audio thread; process()
+    runs every stage in place on one block.
+
+    A chain can also be built from two descriptions, A and B, and morphed
+    between them. Stages are aligned by type (and room, for convolution); a
+    stage present on only one side is morphed towards its identity
+    parameters on the other. The morph position is smoothed per sample and
+    the stage parameters are recomputed every controlInterval samples while
+    it moves.
+
+    New descriptions with the same structure (see hasSameStructure()) don't
+    need a new chain: a ParameterUpdate moves the stages to them in place
+    over updateRampSeconds, keeping filter, delay and reverb state.
+
+    While the input is silent, each stage is put to sleep once its own output
+    has stayed below silenceThreshold for longer than its tail. A sleeping
+    stage is skipped and is reset when sound arrives again, so an idle chain
+    costs one peak scan per block. NaN and infinite samples never count as
+    silence, so they wake the stages and reset their silence count.
+ */
+class EffectChain
+{
+public:
+  /** Linear phase turns every run of filters into one FIR, at the cost of latency. */
+  enum class FilterMode
+  {
+    minimumPhase,
+    linearPhase
+  };
+
+  /** An empty channel layout stands for the usual one for spec.numChannels; see prepare(). */
+  EffectChain(const ChainDescription &description, const juce::dsp::ProcessSpec &spec,
+              FilterMode filterMode = FilterMode::minimumPhase, const juce::AudioChannelSet &channelLayout = {});
+  EffectChain(const ChainDescription &descriptionA, const ChainDescription &descriptionB,
+              float initialMorph, const juce::dsp::ProcessSpec &spec,
+              FilterMode filterMode = FilterMode::minimumPhase, const juce::AudioChannelSet &channelLayout = {});
+
+  //==============================================================================
+  /** With a profiler, every stage is timed and the block's costs are added to it. */
+  void process(juce::dsp::AudioBlock<float> &block, StageProfiler *profiler = nullptr);
+  void reset();
+
+  /**
+      Prepares the built stages for a new spec, as the constructor did for
+      the first one: coefficients, delay and reverb tuning and FIR designs
+      are recomputed and their state cleared, but storage that still fits is
+      reused. Not while process() may be running.
+
+      Reverbs use the channel layout to pair channels by their role. A
+      layout that is empty or doesn't have spec.numChannels channels is
+      replaced by AudioChannelSet::canonicalChannelSet().
+   */
+  void prepare(const juce::dsp::ProcessSpec &spec, const juce::AudioChannelSet &channelLayout = {});
+
+  /** Audio thread. 0 is chain A, 1 is chain B. */
+  void setMorph(float newMorph);
+
+  /** Audio thread. Skips the smoothing, for chains nested in a morphing parallel stage. */
+  void setMorphImmediately(float newMorph);
+
+  //==============================================================================
+  /**
+      New descriptions for a chain, aligned as the constructor aligns them and
+      built off the audio thread. startStages only has to have as many
+      (default) entries as stagesA.
+   */
+  struct ParameterUpdate
+  {
+    juce::uint32 chainId = 0;
+    ChainDescription description, morphTarget;
+    std::vector<StageDescription> stagesA, stagesB, startStages;
+  };
+
+  /**
+      Audio thread. Swaps the update's stages in and ramps every stage's
+      parameters to them from wherever they are now. Never allocates; the
+      replaced data is left in the update, to be freed on another thread.
+   */
+  void applyUpdate(ParameterUpdate &update) noexcept;
+
+  /**
+      True if a chain built from stages a can be updated in place to stages
+      b: the same types in the same places, the same rooms and delay buffer
+      sizes, and identical parallel stages.
+   */
+  static bool hasSameStructure(const std::vector<StageDescription> &a, const std::vector<StageDescription> &b);
+
+  /** What getTailLengthSeconds() would return for a chain built from these aligned stages. */
+  static double computeTailLengthSeconds(const std::vector<StageDescription> &stagesA, const std::vector<StageDescription> &stagesB,
+                                         double sampleRate, FilterMode filterMode);
+
+  /** Pairs up the stages of two descriptions for morphing, as the constructor does. */
+  static void alignForMorph(const ChainDescription &a, const ChainDescription &b,
+                            std::vector<StageDescription> &alignedA, std::vector<StageDescription> &alignedB);
+
+  const ChainDescription &getDescription() const { return description; }
+  const ChainDescription &getMorphTarget() const { return morphTarget; }
+  bool isMorphable() const { return morphable; }
+  int getNumStages() const { return numStages; }
+
+  /** The stage type's name, or "filterCascade" or "linearPhaseFilter" for a merged run of filters. */
+  const char *getStageName(int stage) const;
+  int getNumDescribedStages(int stage) const { return stageRanges[(size_t)stage].length; }
+
+  /** The longest tail either end of the morph can produce: every stage's tail in series. */
+  double getTailLengthSeconds() const { return tailLengthSeconds; }
+
+  int getNumSleepingStages() const;
+
+  /** Delay the chain adds to the whole signal; nonzero only for linear-phase filters. */
+  int getLatencySamples() const { return latencySamples; }
+
+  /** Unique per chain built in this process. */
+  juce::uint32 getId() const { return id; }
+
+  //==============================================================================
+  static constexpr int controlInterval = 32;
+  static constexpr double morphRampSeconds = 0.05;
+  static constexpr double updateRampSeconds = 0.05;
+
+  static constexpr float silenceThreshold = 1.0e-5f; // about -100 dB
+  static constexpr double sleepMarginSeconds = 0.05;
+
+private:
+  //==============================================================================
+  struct StageRange
+  {
+    size_t first;
+    int length;
+  };
+
+  struct StageActivity
+  {
+    juce::int64 silentSamples = 0;
+    juce::int64 samplesBeforeSleep = 0;
+    bool asleep = false;
+  };
+
+  void build(float initialMorph, const juce::dsp::ProcessSpec &spec, FilterMode filterMode,
+             const juce::AudioChannelSet &channelLayout);
+  void processStages(juce::dsp::AudioBlock<float> &block, StageProfiler *profiler, bool inputIsSilent);
+  void processStage(int index, juce::dsp::ProcessContextReplacing<float> &context, StageProfiler *profiler);
+  void applyMorph(float amount);
+  void updateTails();
+
+  static double getStageTailSeconds(const std::vector<StageDescription> &stagesA, const std::vector<StageDescription> &stagesB,
+                                    StageRange range, double sampleRate, FilterMode filterMode);
+  static int getFilterRunLength(const std::vector<StageDescription> &stages, size_t first);
+  static void initialiseStage(ChainStage &stage, const StageDescription &description);
+  static bool isSilent(const juce::dsp::AudioBlock<float> &block);
+
+  //==============================================================================
+  ChainDescription description, morphTarget;
+  bool morphable = false;
+  juce::uint32 id;
+
+  // Per described stage: both ends of the morph, the current interpolation
+  // and where the last parameter update started from
+  std::vector<StageDescription> stagesA, stagesB, workingStages, updateStart;
+
+  std::unique_ptr<ChainStage[]> stages;
+  std::vector<StageRange> stageRanges;
+  std::vector<StageActivity> activity;
+  int numStages = 0;
+  int latencySamples = 0;
+  double tailLengthSeconds = 0.0;
+  double sampleRate = 0.0;
+  FilterMode filterMode = FilterMode::minimumPhase;
+
+  juce::SmoothedValue<float> morph, updateRamp;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EffectChain)
+};
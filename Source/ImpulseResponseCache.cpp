@@ -0,0 +1,206 @@
+/*
+  ==============================================================================
+
+    The built-in impulse responses for the convolution reverb, and a
+    process-wide cache of them already split into transformed partitions.
+
+  ==============================================================================
+*/
+
+#include "ImpulseResponseCache.h"
+
+namespace
+{
+    struct Room
+    {
+        const char *name;
+        double rt60Seconds;
+        double preDelaySeconds;
+        float damping; // 0 keeps the tail as bright as the onset
+    };
+
+    // Append only: stages store the index. Every pre-delay is long enough to
+    // hide a 256-sample partition at 44.1 kHz and above.
+    const Room rooms[] = {
+        {"room", 0.5, 0.006, 0.5f},
+        {"chamber", 1.1, 0.010, 0.4f},
+        {"hall", 2.2, 0.020, 0.3f},
+        {"plate", 1.6, 0.006, 0.1f},
+        {"cathedral", 4.0, 0.035, 0.45f},
+    };
+
+    constexpr int numChannels = 2;
+    constexpr int numEarlyReflections = 12;
+    constexpr double earlyReflectionSeconds = 0.08;
+}
+
+//==============================================================================
+std::shared_ptr<const PartitionedImpulseResponse> PartitionedImpulseResponse::create(const juce::AudioBuffer<float> &impulse, int partitionSize)
+{
+    jassert(juce::isPowerOfTwo(partitionSize));
+
+    // Leading silence shared by every channel stands in for the convolver's latency
+    auto trim = 0;
+    while (trim < partitionSize && trim < impulse.getNumSamples())
+    {
+        auto silent = true;
+        for (int channel = 0; channel < impulse.getNumChannels(); ++channel)
+            silent = silent && impulse.getSample(channel, trim) == 0.0f;
+
+        if (!silent)
+            break;
+
+        ++trim;
+    }
+
+    auto length = impulse.getNumSamples() - trim;
+
+    auto response = std::make_shared<PartitionedImpulseResponse>();
+    response->allocate(partitionSize, juce::jmax(1, (length + partitionSize - 1) / partitionSize), impulse.getNumChannels());
+    response->latencySamples = partitionSize - trim;
+
+    juce::dsp::FFT fft(juce::roundToInt(std::log2(2 * partitionSize)));
+    std::vector<float> scratch((size_t)(4 * partitionSize));
+
+    for (int channel = 0; channel < response->numChannels; ++channel)
+        response->setChannel(channel, impulse.getReadPointer(channel) + trim, length, fft, scratch.data());
+
+    return response;
+}
+
+void PartitionedImpulseResponse::allocate(int newPartitionSize, int newNumPartitions, int newNumChannels)
+{
+    partitionSize = newPartitionSize;
+    numBins = partitionSize + 1;
+    numPartitions = newNumPartitions;
+    numChannels = newNumChannels;
+    latencySamples = partitionSize;
+    spectra.assign((size_t)numChannels * (size_t)numPartitions * 2 * (size_t)numBins, 0.0f);
+}
+
+void PartitionedImpulseResponse::setChannel(int channel, const float *impulse, int numSamples, const juce::dsp::FFT &fft, float *scratch) noexcept
+{
+    jassert(fft.getSize() == 2 * partitionSize);
+
+    for (int p = 0; p < numPartitions; ++p)
+    {
+        // Each partition zero-padded to twice its length, as overlap-save needs
+        std::fill(scratch, scratch + 4 * partitionSize, 0.0f);
+
+        auto start = p * partitionSize;
+        auto count = juce::jlimit(0, partitionSize, numSamples - start);
+        if (count > 0)
+            std::copy_n(impulse + start, count, scratch);
+
+        fft.performRealOnlyForwardTransform(scratch, true);
+
+        auto *real = getReal(channel, p);
+        auto *imag = getImag(channel, p);
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            real[bin] = scratch[2 * bin];
+            imag[bin] = scratch[2 * bin + 1];
+        }
+    }
+}
+
+//==============================================================================
+int ImpulseResponseCache::getNumImpulseResponses()
+{
+    return juce::numElementsInArray(rooms);
+}
+
+const char *ImpulseResponseCache::getName(int index)
+{
+    return rooms[juce::jlimit(0, getNumImpulseResponses() - 1, index)].name;
+}
+
+int ImpulseResponseCache::findIndex(const juce::String &name)
+{
+    for (int i = 0; i < getNumImpulseResponses(); ++i)
+        if (name.equalsIgnoreCase(rooms[i].name))
+            return i;
+
+    return -1;
+}
+
+double ImpulseResponseCache::getLengthSeconds(int index)
+{
+    auto &room = rooms[juce::jlimit(0, getNumImpulseResponses() - 1, index)];
+    return room.preDelaySeconds + room.rt60Seconds;
+}
+
+//==============================================================================
+std::shared_ptr<const PartitionedImpulseResponse> ImpulseResponseCache::get(int index, double sampleRate, int partitionSize)
+{
+    jassert(juce::isPositiveAndBelow(index, getNumImpulseResponses()));
+
+    const juce::ScopedLock sl(lock);
+
+    for (auto &entry : entries)
+        if (entry.index == index && entry.sampleRate == sampleRate && entry.partitionSize == partitionSize)
+            return entry.response;
+
+    auto response = PartitionedImpulseResponse::create(generate(index, sampleRate), partitionSize);
+    entries.push_back({index, sampleRate, partitionSize, response});
+    return response;
+}
+
+int ImpulseResponseCache::getNumCached() const
+{
+    const juce::ScopedLock sl(lock);
+    return static_cast<int>(entries.size());
+}
+
+//==============================================================================
+juce::AudioBuffer<float> ImpulseResponseCache::generate(int index, double sampleRate)
+{
+    auto &room = rooms[juce::jlimit(0, getNumImpulseResponses() - 1, index)];
+
+    auto numSamples = static_cast<int>(std::ceil(getLengthSeconds(index) * sampleRate));
+    auto preDelay = juce::roundToInt(room.preDelaySeconds * sampleRate);
+    auto numTailSamples = juce::jmax(1, numSamples - preDelay);
+
+    // Falls by 60 dB over the RT60
+    auto decayPerSample = static_cast<float>(std::exp(std::log(1.0e-3) / (room.rt60Seconds * sampleRate)));
+
+    juce::AudioBuffer<float> impulse(numChannels, numSamples);
+    impulse.clear();
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        // Seeded per room and channel, so every instance generates the same response
+        juce::Random random(juce::String(room.name).hashCode64() + channel);
+        auto *samples = impulse.getWritePointer(channel);
+
+        // Diffuse tail: noise through a one-pole low-pass that closes as it decays
+        auto envelope = 1.0f, lowpassed = 0.0f;
+        for (int i = preDelay; i < numSamples; ++i)
+        {
+            auto coefficient = room.damping * static_cast<float>(i - preDelay) / static_cast<float>(numTailSamples);
+            lowpassed += (1.0f - coefficient) * (random.nextFloat() * 2.0f - 1.0f - lowpassed);
+            samples[i] = lowpassed * envelope;
+            envelope *= decayPerSample;
+        }
+
+        // Sparse early reflections, the first one right at the pre-delay
+        auto earlySamples = juce::jmin(numTailSamples, static_cast<int>(earlyReflectionSeconds * sampleRate));
+        for (int r = 0; r < numEarlyReflections; ++r)
+        {
+            auto offset = r == 0 ? 0 : random.nextInt(earlySamples);
+            auto amplitude = 1.0f - static_cast<float>(offset) / static_cast<float>(earlySamples);
+            samples[preDelay + offset] += (random.nextBool() ? 1.0f : -1.0f) * amplitude;
+        }
+    }
+
+    // Unit energy per channel, so white noise comes out at roughly the level it went in
+    auto energy = 0.0;
+    for (int channel = 0; channel < numChannels; ++channel)
+        for (int i = 0; i < numSamples; ++i)
+            energy += juce::square(static_cast<double>(impulse.getSample(channel, i)));
+
+    if (energy > 0.0)
+        impulse.applyGain(static_cast<float>(1.0 / std::sqrt(energy / numChannels)));
+
+    return impulse;
+}
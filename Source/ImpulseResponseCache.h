@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+    The built-in impulse responses for the convolution reverb, and a
+    process-wide cache of them already split into transformed partitions.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    An impulse response ready for uniformly partitioned convolution: every
+    block of partitionSize samples, zero-padded to twice that and transformed,
+    with real and imaginary parts stored apart so the spectral multiply-add
+    vectorises.
+
+    The convolver adds partitionSize samples of latency; as much of it as the
+    response's leading silence allows is taken off the front by create(), so
+    a response with enough pre-delay is heard with none.
+ */
+struct PartitionedImpulseResponse
+{
+  /** Partitions and transforms every channel of the response. */
+  static std::shared_ptr<const PartitionedImpulseResponse> create(const juce::AudioBuffer<float> &impulse, int partitionSize);
+
+  /** Sizes the spectra for a response of up to numPartitions * partitionSize samples. */
+  void allocate(int partitionSize, int numPartitions, int numChannels);
+
+  /**
+      Partitions and transforms one channel in place, without allocating.
+      fft must be of size 2 * partitionSize and scratch hold 4 * partitionSize
+      floats. Samples beyond the allocated length are ignored.
+   */
+  void setChannel(int channel, const float *impulse, int numSamples, const juce::dsp::FFT &fft, float *scratch) noexcept;
+
+  int partitionSize = 0;
+  int numBins = 0; // partitionSize + 1
+  int numPartitions = 0;
+  int numChannels = 0;
+  int latencySamples = 0; // what trimming the leading silence couldn't cover
+
+  const float *getReal(int channel, int partition) const noexcept { return spectra.data() + getOffset(channel, partition); }
+  const float *getImag(int channel, int partition) const noexcept { return getReal(channel, partition) + numBins; }
+  float *getReal(int channel, int partition) noexcept { return spectra.data() + getOffset(channel, partition); }
+  float *getImag(int channel, int partition) noexcept { return getReal(channel, partition) + numBins; }
+
+  std::vector<float> spectra;
+
+private:
+  size_t getOffset(int channel, int partition) const noexcept
+  {
+    return ((size_t)channel * (size_t)numPartitions + (size_t)partition) * 2 * (size_t)numBins;
+  }
+};
+
+//==============================================================================
+/**
+    The responses are synthesised rather than shipped as files: decorrelated
+    noise per channel with a few early reflections, an exponential decay to
+    -60 dB over the room's RT60 and high frequencies dying away faster.
+    Each one is generated and partitioned once per sample rate and partition
+    size, and every convolution stage in the process shares the result.
+
+    Stages refer to a response by its index in the built-in list, which is
+    what the plugin state stores, so new rooms are only ever appended.
+
+    Shared across the process; use it through juce::SharedResourcePointer.
+ */
+class ImpulseResponseCache
+{
+public:
+  //==============================================================================
+  static int getNumImpulseResponses();
+  static const char *getName(int index);
+
+  /** The index of the named response, or -1. Case-insensitive. */
+  static int findIndex(const juce::String &name);
+
+  /** The response's length, pre-delay included. */
+  static double getLengthSeconds(int index);
+
+  //==============================================================================
+  /** Any thread but the audio thread. The first request for a combination does the work, under the lock. */
+  std::shared_ptr<const PartitionedImpulseResponse> get(int index, double sampleRate, int partitionSize);
+
+  int getNumCached() const;
+
+  /** The raw response, before partitioning. */
+  static juce::AudioBuffer<float> generate(int index, double sampleRate);
+
+private:
+  //==============================================================================
+  struct Entry
+  {
+    int index;
+    double sampleRate;
+    int partitionSize;
+    std::shared_ptr<const PartitionedImpulseResponse> response;
+  };
+
+  juce::CriticalSection lock;
+  std::vector<Entry> entries;
+};
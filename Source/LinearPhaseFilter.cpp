@@ -0,0 +1,259 @@
+/*
+  ==============================================================================
+
+    Linear-phase alternative to FilterCascadeStage: the combined magnitude
+    response of a run of filters, applied as one FIR by FFT convolution.
+
+  ==============================================================================
+*/
+
+#include "LinearPhaseFilter.h"
+#include "BiquadDesign.h"
+#include "RealtimeWatchdog.h"
+
+//==============================================================================
+LinearPhaseDesigner::LinearPhaseDesigner()
+    : juce::Thread("SemanticEQ linear-phase designer")
+{
+    startThread();
+}
+
+LinearPhaseDesigner::~LinearPhaseDesigner()
+{
+    stopThread(pollIntervalMs * 100);
+}
+
+void LinearPhaseDesigner::add(LinearPhaseFilterStage *stage)
+{
+    const juce::ScopedLock sl(lock);
+    stages.addIfNotAlreadyThere(stage);
+}
+
+void LinearPhaseDesigner::remove(LinearPhaseFilterStage *stage)
+{
+    const juce::ScopedLock sl(lock);
+    stages.removeFirstMatchingValue(stage);
+}
+
+void LinearPhaseDesigner::run()
+{
+    while (!threadShouldExit())
+    {
+        {
+            const juce::ScopedLock sl(lock);
+            for (auto *stage : stages)
+                stage->designIfRequested();
+        }
+
+        wait(pollIntervalMs);
+    }
+}
+
+//==============================================================================
+LinearPhaseFilterStage::LinearPhaseFilterStage() = default;
+
+LinearPhaseFilterStage::~LinearPhaseFilterStage()
+{
+    if (registered)
+        designer->remove(this);
+}
+
+void LinearPhaseFilterStage::setParameters(const StageDescription *firstSection, int numSections)
+{
+    jassert(!registered);
+    sections.assign(firstSection, firstSection + numSections);
+}
+
+void LinearPhaseFilterStage::setSection(int index, const StageDescription &section)
+{
+    sections[(size_t)index] = section;
+    sectionsChanged = true;
+}
+
+int LinearPhaseFilterStage::getFirLength(double sampleRate)
+{
+    return juce::jlimit(1024, 32768, juce::nextPowerOfTwo(static_cast<int>(std::ceil(sampleRate * minimumFirSeconds))));
+}
+
+void LinearPhaseFilterStage::prepare(const juce::dsp::ProcessSpec &spec)
+{
+    if (registered)
+    {
+        designer->remove(this);
+        registered = false;
+    }
+
+    sampleRate = spec.sampleRate;
+    firLength = getFirLength(sampleRate);
+
+    // Kept when re-prepared at a rate that needs the same FIR length
+    if (firFft == nullptr || firFft->getSize() != firLength)
+        firFft = std::make_unique<juce::dsp::FFT>(juce::roundToInt(std::log2(firLength)));
+    if (partitionFft == nullptr)
+        partitionFft = std::make_unique<juce::dsp::FFT>(juce::roundToInt(std::log2(2 * partitionSize)));
+
+    firScratch.assign((size_t)(2 * firLength), 0.0f);
+    partitionScratch.assign((size_t)(4 * partitionSize), 0.0f);
+
+    // One FIR shared by every channel
+    for (auto &response : responses)
+        response.allocate(partitionSize, firLength / partitionSize, 1);
+
+    requestedSections = sections;
+    designSections = sections;
+    hasRequest = false;
+    sectionsChanged = false;
+
+    design(designSections, responses[0]);
+    convolver.prepare(responses[0], static_cast<int>(spec.numChannels));
+    playing = 0;
+    retiring = -1;
+
+    readyFifo.reset();
+    freeFifo.reset();
+    for (int i = 1; i < numResponses; ++i)
+        push(freeFifo, freeQueue, i);
+
+    designer->add(this);
+    registered = true;
+}
+
+//==============================================================================
+void LinearPhaseFilterStage::process(const juce::dsp::ProcessContextReplacing<float> &context)
+{
+    SEMANTICEQ_RT_TAG("LinearPhaseFilterStage::process");
+
+    // If the designer holds the lock, the request goes with the next block
+    if (sectionsChanged)
+    {
+        const juce::SpinLock::ScopedTryLockType tryLock(requestLock);
+        if (tryLock.isLocked())
+        {
+            std::copy(sections.begin(), sections.end(), requestedSections.begin());
+            hasRequest = true;
+            sectionsChanged = false;
+        }
+    }
+
+    takeNewestResponse();
+    convolver.process(context.getOutputBlock(), 0.0f, 1.0f);
+}
+
+void LinearPhaseFilterStage::takeNewestResponse() noexcept
+{
+    // The outgoing FIR is read until the convolver's crossfade has finished
+    if (retiring >= 0)
+    {
+        if (convolver.isCrossfading())
+            return;
+
+        push(freeFifo, freeQueue, retiring);
+        retiring = -1;
+    }
+
+    auto newest = -1;
+    for (auto index = pop(readyFifo, readyQueue); index >= 0; index = pop(readyFifo, readyQueue))
+    {
+        if (newest >= 0)
+            push(freeFifo, freeQueue, newest);
+
+        newest = index;
+    }
+
+    if (newest < 0)
+        return;
+
+    convolver.crossfadeTo(responses[(size_t)newest]);
+    retiring = playing;
+    playing = newest;
+}
+
+void LinearPhaseFilterStage::reset()
+{
+    convolver.reset();
+}
+
+//==============================================================================
+bool LinearPhaseFilterStage::designIfRequested()
+{
+    if (!hasRequest.load())
+        return false;
+
+    // Every response is queued or playing; try again on the next poll
+    auto target = pop(freeFifo, freeQueue);
+    if (target < 0)
+        return false;
+
+    {
+        const juce::SpinLock::ScopedLockType sl(requestLock);
+        designSections = requestedSections;
+        hasRequest = false;
+    }
+
+    design(designSections, responses[(size_t)target]);
+    push(readyFifo, readyQueue, target);
+    return true;
+}
+
+void LinearPhaseFilterStage::design(const std::vector<StageDescription> &runSections, PartitionedImpulseResponse &response)
+{
+    using juce::MathConstants;
+
+    auto numBins = firLength / 2 + 1;
+    auto *spectrum = firScratch.data();
+
+    // Zero-phase magnitude of the whole run; (-1)^bin then delays it by half the FIR
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        spectrum[2 * bin] = (bin % 2 == 0) ? 1.0f : -1.0f;
+        spectrum[2 * bin + 1] = 0.0f;
+    }
+    std::fill(spectrum + 2 * numBins, spectrum + 2 * firLength, 0.0f);
+
+    for (auto &section : runSections)
+    {
+        BiquadCascade::Coefficients c;
+        auto &p = section.parameters;
+        BiquadDesign::design(section.type, sampleRate, p[0], p[1], p[2], c);
+
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            auto omega = MathConstants<double>::twoPi * bin / firLength;
+            auto cos1 = std::cos(omega), cos2 = std::cos(2.0 * omega);
+            auto sin1 = std::sin(omega), sin2 = std::sin(2.0 * omega);
+
+            auto numerator = std::hypot(c.b0 + c.b1 * cos1 + c.b2 * cos2, c.b1 * sin1 + c.b2 * sin2);
+            auto denominator = std::hypot(1.0 + c.a1 * cos1 + c.a2 * cos2, c.a1 * sin1 + c.a2 * sin2);
+
+            spectrum[2 * bin] *= static_cast<float>(numerator / juce::jmax(denominator, 1.0e-12));
+        }
+    }
+
+    firFft->performRealOnlyInverseTransform(spectrum);
+
+    // Symmetric about the centre tap, so the window keeps the phase linear
+    for (int n = 0; n < firLength; ++n)
+        spectrum[n] *= 0.5f - 0.5f * std::cos(MathConstants<float>::twoPi * static_cast<float>(n) / static_cast<float>(firLength));
+
+    response.setChannel(0, spectrum, firLength, *partitionFft, partitionScratch.data());
+}
+
+//==============================================================================
+bool LinearPhaseFilterStage::push(juce::AbstractFifo &fifo, std::array<int, numResponses + 1> &queue, int index) noexcept
+{
+    const auto scope = fifo.write(1);
+    if (scope.blockSize1 + scope.blockSize2 == 0)
+        return false;
+
+    queue[(size_t)(scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2)] = index;
+    return true;
+}
+
+int LinearPhaseFilterStage::pop(juce::AbstractFifo &fifo, const std::array<int, numResponses + 1> &queue) noexcept
+{
+    const auto scope = fifo.read(1);
+    if (scope.blockSize1 + scope.blockSize2 == 0)
+        return -1;
+
+    return queue[(size_t)(scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2)];
+}
@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+
+    Linear-phase alternative to FilterCascadeStage: the combined magnitude
+    response of a run of filters, applied as one FIR by FFT convolution.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChainDescription.h"
+#include "PartitionedConvolver.h"
+
+class LinearPhaseFilterStage;
+
+//==============================================================================
+/**
+    One background thread for the process that redesigns the FIRs of every
+    linear-phase stage whose filters have changed while it plays. Stages
+    register themselves once prepared; designing happens under the same lock
+    that removing a stage takes, so a stage is never destroyed mid-design.
+
+    Shared across the process; use it through juce::SharedResourcePointer.
+ */
+class LinearPhaseDesigner : private juce::Thread
+{
+public:
+  LinearPhaseDesigner();
+  ~LinearPhaseDesigner() override;
+
+  void add(LinearPhaseFilterStage *stage);
+  void remove(LinearPhaseFilterStage *stage);
+
+  static constexpr int pollIntervalMs = 10;
+
+private:
+  void run() override;
+
+  juce::CriticalSection lock;
+  juce::Array<LinearPhaseFilterStage *> stages;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LinearPhaseDesigner)
+};
+
+//==============================================================================
+/**
+    Evaluates the magnitude of every section on an FFT grid, multiplies them
+    together and turns the product into a symmetric, Hann-windowed FIR of
+    getFirLength() taps, which a PartitionedConvolver applies. The cost per
+    sample is the same for one band as for twenty; the price is
+    getLatencySamples() of delay, half the FIR plus one partition.
+
+    The first FIR is designed in prepare(). After that setSection() (audio
+    thread, while morphing) hands the new sections to the LinearPhaseDesigner
+    through a try-lock and the finished FIR comes back through a lock-free
+    queue of preallocated responses, crossfaded in over one partition.
+ */
+class LinearPhaseFilterStage
+{
+public:
+  LinearPhaseFilterStage();
+  ~LinearPhaseFilterStage();
+
+  void setParameters(const StageDescription *firstSection, int numSections);
+
+  /** Audio thread. The FIR follows a few milliseconds later. */
+  void setSection(int index, const StageDescription &section);
+
+  void prepare(const juce::dsp::ProcessSpec &spec);
+  void process(const juce::dsp::ProcessContextReplacing<float> &context);
+  void reset();
+
+  //==============================================================================
+  static int getFirLength(double sampleRate);
+  static int getLatencySamples(double sampleRate) { return getFirLength(sampleRate) / 2 + partitionSize; }
+
+  static constexpr int partitionSize = 256;
+  static constexpr double minimumFirSeconds = 0.085; // resolves a low shelf at 100 Hz or so
+  static constexpr int numResponses = 4;
+
+private:
+  friend class LinearPhaseDesigner;
+
+  //==============================================================================
+  /** Designer thread. Returns true if it designed a new FIR. */
+  bool designIfRequested();
+  void design(const std::vector<StageDescription> &runSections, PartitionedImpulseResponse &response);
+
+  void takeNewestResponse() noexcept;
+  static bool push(juce::AbstractFifo &fifo, std::array<int, numResponses + 1> &queue, int index) noexcept;
+  static int pop(juce::AbstractFifo &fifo, const std::array<int, numResponses + 1> &queue) noexcept;
+
+  //==============================================================================
+  // Audio thread once prepared
+  std::vector<StageDescription> sections;
+  bool sectionsChanged = false;
+  int playing = 0, retiring = -1;
+  PartitionedConvolver convolver;
+
+  // Handed to the designer under the try-lock
+  juce::SpinLock requestLock;
+  std::vector<StageDescription> requestedSections;
+  std::atomic<bool> hasRequest{false};
+
+  // Indices into responses: designed ones to the audio thread, unused ones back
+  std::array<PartitionedImpulseResponse, numResponses> responses;
+  juce::AbstractFifo readyFifo{numResponses + 1}, freeFifo{numResponses + 1};
+  std::array<int, numResponses + 1> readyQueue{}, freeQueue{};
+
+  // Designer thread (and prepare(), before the stage is registered)
+  std::vector<StageDescription> designSections;
+  std::unique_ptr<juce::dsp::FFT> firFft, partitionFft;
+  std::vector<float> firScratch, partitionScratch;
+
+  double sampleRate = 0.0;
+  int firLength = 0;
+
+  juce::SharedResourcePointer<LinearPhaseDesigner> designer;
+  bool registered = false;
+
+  JUCE_DECLARE_NON_COPYABLE(LinearPhaseFilterStage)
+};
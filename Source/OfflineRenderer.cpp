@@ -0,0 +1,314 @@
+/*
+  ==============================================================================
+
+    Renders audio through an effect chain outside of any plugin host.
+
+  ==============================================================================
+*/
+
+#include "OfflineRenderer.h"
+#include "EffectChain.h"
+
+//==============================================================================
+OfflineRenderer::OfflineRenderer(const ChainDescription &chainIn, int blockSizeIn)
+    : chain(chainIn),
+      blockSize(juce::jmax(1, blockSizeIn))
+{
+}
+
+//==============================================================================
+void OfflineRenderer::render(juce::AudioBuffer<float> &buffer, double sampleRate, const juce::AudioChannelSet &channelLayout) const
+{
+    EffectChain effectChain(chain, {sampleRate, static_cast<juce::uint32>(blockSize), static_cast<juce::uint32>(buffer.getNumChannels())},
+                            EffectChain::FilterMode::minimumPhase, channelLayout);
+
+    juce::dsp::AudioBlock<float> block(buffer);
+    for (size_t start = 0; start < block.getNumSamples(); start += (size_t)blockSize)
+    {
+        auto subBlock = block.getSubBlock(start, juce::jmin((size_t)blockSize, block.getNumSamples() - start));
+        effectChain.process(subBlock);
+    }
+}
+
+OfflineRenderer::Result OfflineRenderer::renderFile(const juce::File &input, const juce::File &output) const
+{
+    Result result;
+
+    auto reader = createReader(input, result);
+    if (reader == nullptr)
+        return result;
+
+    auto writer = createWriter(output, *reader, result);
+    if (writer == nullptr)
+        return result;
+
+    auto start = juce::Time::getHighResolutionTicks();
+
+    auto numChannels = static_cast<int>(reader->numChannels);
+    EffectChain effectChain(chain, {reader->sampleRate, static_cast<juce::uint32>(blockSize), static_cast<juce::uint32>(numChannels)},
+                            EffectChain::FilterMode::minimumPhase, reader->getChannelLayout());
+    juce::AudioBuffer<float> buffer(numChannels, blockSize);
+
+    for (juce::int64 position = 0; position < reader->lengthInSamples; position += blockSize)
+    {
+        auto numSamples = static_cast<int>(juce::jmin((juce::int64)blockSize, reader->lengthInSamples - position));
+
+        if (!reader->read(&buffer, 0, numSamples, position, true, true))
+        {
+            result.error = "read failed";
+            return result;
+        }
+
+        juce::dsp::AudioBlock<float> block(buffer.getArrayOfWritePointers(), (size_t)numChannels, (size_t)numSamples);
+        effectChain.process(block);
+
+        if (!writer->writeFromAudioSampleBuffer(buffer, 0, numSamples))
+        {
+            result.error = "write failed";
+            return result;
+        }
+    }
+
+    result.succeeded = true;
+    result.numSamples = reader->lengthInSamples;
+    result.sampleRate = reader->sampleRate;
+    result.renderSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+    return result;
+}
+
+//==============================================================================
+void OfflineRenderer::renderSegmented(juce::AudioBuffer<float> &buffer, double sampleRate,
+                                      juce::ThreadPool &pool, const SegmentOptions &options,
+                                      const juce::AudioChannelSet &channelLayout) const
+{
+    // Segments read the untouched input, so the output is written to a copy
+    juce::AudioBuffer<float> rendered(buffer.getNumChannels(), buffer.getNumSamples());
+    int writePosition = 0;
+
+    renderSegments(buffer.getNumChannels(), buffer.getNumSamples(), sampleRate, pool, options, channelLayout,
+                   [&buffer]
+                   {
+                       return [&buffer](juce::AudioBuffer<float> &destination, juce::int64 sourceStart)
+                       {
+                           for (int channel = 0; channel < destination.getNumChannels(); ++channel)
+                               destination.copyFrom(channel, 0, buffer, channel, static_cast<int>(sourceStart), destination.getNumSamples());
+                           return true;
+                       };
+                   },
+                   [&rendered, &writePosition](const juce::AudioBuffer<float> &source, int numSamples)
+                   {
+                       for (int channel = 0; channel < rendered.getNumChannels(); ++channel)
+                           rendered.copyFrom(channel, writePosition, source, channel, 0, numSamples);
+                       writePosition += numSamples;
+                       return true;
+                   });
+
+    buffer.makeCopyOf(rendered, true);
+}
+
+OfflineRenderer::Result OfflineRenderer::renderFileSegmented(const juce::File &input, const juce::File &output,
+                                                             juce::ThreadPool &pool, const SegmentOptions &options) const
+{
+    Result result;
+
+    auto reader = createReader(input, result);
+    if (reader == nullptr)
+        return result;
+
+    auto writer = createWriter(output, *reader, result);
+    if (writer == nullptr)
+        return result;
+
+    auto start = juce::Time::getHighResolutionTicks();
+
+    // Readers aren't thread safe, so every segment opens its own
+    auto succeeded = renderSegments(static_cast<int>(reader->numChannels), reader->lengthInSamples, reader->sampleRate, pool, options,
+                                    reader->getChannelLayout(),
+                                    [&input]() -> SourceReader
+                                    {
+                                        auto formatManager = std::make_shared<juce::AudioFormatManager>();
+                                        formatManager->registerBasicFormats();
+                                        std::shared_ptr<juce::AudioFormatReader> segmentReader(formatManager->createReaderFor(input));
+
+                                        return [formatManager, segmentReader](juce::AudioBuffer<float> &destination, juce::int64 sourceStart)
+                                        {
+                                            return segmentReader != nullptr
+                                                && segmentReader->read(&destination, 0, destination.getNumSamples(), sourceStart, true, true);
+                                        };
+                                    },
+                                    [&writer](const juce::AudioBuffer<float> &source, int numSamples)
+                                    {
+                                        return writer->writeFromAudioSampleBuffer(source, 0, numSamples);
+                                    });
+
+    if (!succeeded)
+    {
+        result.error = "segment render failed";
+        return result;
+    }
+
+    result.succeeded = true;
+    result.numSamples = reader->lengthInSamples;
+    result.sampleRate = reader->sampleRate;
+    result.renderSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+    return result;
+}
+
+bool OfflineRenderer::renderSegments(int numChannels, juce::int64 length, double sampleRate,
+                                     juce::ThreadPool &pool, const SegmentOptions &options,
+                                     const juce::AudioChannelSet &channelLayout,
+                                     const std::function<SourceReader()> &createSourceReader,
+                                     const OutputWriter &write) const
+{
+    auto segmentLength = juce::jmax((juce::int64)blockSize, (juce::int64)(options.segmentSeconds * sampleRate));
+    auto preRoll = juce::jmax((juce::int64)0, (juce::int64)(options.preRollSeconds * sampleRate));
+    auto crossfade = static_cast<int>(juce::jlimit((juce::int64)0, segmentLength, (juce::int64)(options.crossfadeSeconds * sampleRate)));
+
+    struct Segment
+    {
+        juce::int64 start = 0;
+        int length = 0, overlap = 0;
+        juce::AudioBuffer<float> output; // length + overlap samples
+        bool succeeded = false;
+        std::atomic<bool> finished{false};
+    };
+
+    auto numSegments = static_cast<size_t>((length + segmentLength - 1) / segmentLength);
+    std::unique_ptr<Segment[]> segments(new Segment[numSegments]);
+    juce::WaitableEvent segmentFinished;
+
+    for (size_t i = 0; i < numSegments; ++i)
+    {
+        auto &segment = segments[i];
+        segment.start = static_cast<juce::int64>(i) * segmentLength;
+        segment.length = static_cast<int>(juce::jmin(segmentLength, length - segment.start));
+
+        // Every segment but the last runs on into the next one's crossfade
+        segment.overlap = static_cast<int>(juce::jmin((juce::int64)crossfade, length - segment.start - segment.length));
+    }
+
+    auto queueSegment = [this, &pool, &segmentFinished, &channelLayout, &createSourceReader, numChannels, preRoll, sampleRate](Segment &segment)
+    {
+        pool.addJob([this, &segment, &segmentFinished, &channelLayout, &createSourceReader, numChannels, preRoll, sampleRate]
+                    {
+                        auto renderStart = juce::jmax((juce::int64)0, segment.start - preRoll);
+                        auto skip = static_cast<int>(segment.start - renderStart);
+
+                        juce::AudioBuffer<float> buffer(numChannels, skip + segment.length + segment.overlap);
+                        auto read = createSourceReader();
+
+                        if (read(buffer, renderStart))
+                        {
+                            render(buffer, sampleRate, channelLayout);
+
+                            segment.output.setSize(numChannels, segment.length + segment.overlap);
+                            for (int channel = 0; channel < numChannels; ++channel)
+                                segment.output.copyFrom(channel, 0, buffer, channel, skip, segment.output.getNumSamples());
+
+                            segment.succeeded = true;
+                        }
+
+                        segment.finished = true;
+                        segmentFinished.signal();
+                    });
+    };
+
+    // Enough queued to keep every thread busy while the next one in order is
+    // written, but no more, so a long file never sits in memory all at once
+    auto maxInFlight = static_cast<size_t>(2 * juce::jmax(1, pool.getNumThreads()));
+    size_t numQueued = 0;
+
+    // Stitch in order as segments finish; later ones keep rendering meanwhile
+    auto succeeded = true;
+    juce::AudioBuffer<float> previousTail;
+
+    for (size_t i = 0; i < numSegments; ++i)
+    {
+        // After a failure nothing new is queued, only what's running is waited for
+        while (succeeded && numQueued < numSegments && numQueued < i + maxInFlight)
+            queueSegment(segments[numQueued++]);
+
+        if (i >= numQueued)
+            break;
+
+        auto &segment = segments[i];
+        while (!segment.finished)
+            segmentFinished.wait(50);
+
+        if (!succeeded || !segment.succeeded)
+        {
+            succeeded = false;
+            segment.output.setSize(0, 0);
+            continue;
+        }
+
+        // Fade from the previous segment's overrun into this segment's head
+        for (int channel = 0; channel < numChannels && previousTail.getNumSamples() > 0; ++channel)
+        {
+            auto fadeLength = previousTail.getNumSamples();
+            segment.output.applyGainRamp(channel, 0, fadeLength, 0.0f, 1.0f);
+            segment.output.addFromWithRamp(channel, 0, previousTail.getReadPointer(channel), fadeLength, 1.0f, 0.0f);
+        }
+
+        succeeded = write(segment.output, segment.length);
+
+        previousTail.setSize(numChannels, segment.overlap);
+        for (int channel = 0; channel < numChannels; ++channel)
+            previousTail.copyFrom(channel, 0, segment.output, channel, segment.length, segment.overlap);
+
+        segment.output.setSize(0, 0);
+    }
+
+    return succeeded;
+}
+
+//==============================================================================
+std::unique_ptr<juce::AudioFormatReader> OfflineRenderer::createReader(const juce::File &input, Result &result)
+{
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(input));
+    if (reader == nullptr)
+    {
+        result.error = "unreadable audio file";
+        return nullptr;
+    }
+
+    if (reader->numChannels < 1)
+    {
+        result.error = "no audio channels";
+        return nullptr;
+    }
+
+    return reader;
+}
+
+std::unique_ptr<juce::AudioFormatWriter> OfflineRenderer::createWriter(const juce::File &output, const juce::AudioFormatReader &reader,
+                                                                       Result &result)
+{
+    // WAV can't hold every depth a compressed source reports
+    auto bitsPerSample = static_cast<int>(reader.bitsPerSample);
+    if (bitsPerSample != 16 && bitsPerSample != 24 && bitsPerSample != 32)
+        bitsPerSample = 24;
+
+    output.deleteFile();
+    std::unique_ptr<juce::FileOutputStream> stream(output.createOutputStream());
+    if (stream == nullptr)
+    {
+        result.error = "can't write " + output.getFullPathName();
+        return nullptr;
+    }
+
+    juce::WavAudioFormat wavFormat;
+    std::unique_ptr<juce::AudioFormatWriter> writer(wavFormat.createWriterFor(stream.get(), reader.sampleRate,
+                                                                              reader.numChannels, bitsPerSample, {}, 0));
+    if (writer == nullptr)
+    {
+        result.error = "can't create a WAV writer";
+        return nullptr;
+    }
+
+    stream.release(); // now owned by the writer
+    return writer;
+}
@@ -0,0 +1,105 @@
+/*
+  ==============================================================================
+
+    Renders audio through an effect chain outside of any plugin host.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChainDescription.h"
+
+//==============================================================================
+/**
+    Holds a chain description and builds a fresh EffectChain for every render,
+    so one renderer can be shared by several threads rendering different
+    files at once. Files are streamed block by block and written as WAV.
+
+    A single long file can instead be split into segments that render in
+    parallel. Each segment starts with a pre-roll of the preceding audio so
+    that filter, compressor and reverb state has converged by the time its
+    own output begins, and neighbouring segments overlap by a short
+    crossfade. At most two segments per pool thread are in flight, and each
+    is written as soon as those before it are, so memory use doesn't grow
+    with the length of the file. The LFOs of phaser and chorus stages
+    restart in every segment, so with those the result is only
+    perceptually, not numerically, close to a serial render.
+ */
+class OfflineRenderer
+{
+public:
+  struct Result
+  {
+    bool succeeded = false;
+    juce::String error;
+
+    juce::int64 numSamples = 0;
+    double sampleRate = 0.0;
+    double renderSeconds = 0.0;
+
+    double getAudioSeconds() const { return sampleRate > 0.0 ? static_cast<double>(numSamples) / sampleRate : 0.0; }
+  };
+
+  struct SegmentOptions
+  {
+    double segmentSeconds = 30.0;
+    double preRollSeconds = 3.0;
+    double crossfadeSeconds = 0.01;
+  };
+
+  explicit OfflineRenderer(const ChainDescription &chain, int blockSize = defaultBlockSize);
+
+  //==============================================================================
+  /**
+      Processes the whole buffer in place, in blocks of getBlockSize(). The
+      channel layout decides how reverbs pair channels; see EffectChain::prepare().
+   */
+  void render(juce::AudioBuffer<float> &buffer, double sampleRate, const juce::AudioChannelSet &channelLayout = {}) const;
+
+  /**
+      Reads any format juce_audio_formats knows and writes a WAV with the same
+      bit depth. The channel layout is the one the reader reports.
+   */
+  Result renderFile(const juce::File &input, const juce::File &output) const;
+
+  /** Like render(), but segments run as jobs on the pool. Blocks until all are done. */
+  void renderSegmented(juce::AudioBuffer<float> &buffer, double sampleRate,
+                       juce::ThreadPool &pool, const SegmentOptions &options,
+                       const juce::AudioChannelSet &channelLayout = {}) const;
+
+  /** Like renderFile(), but segments run as jobs on the pool. Blocks until all are done. */
+  Result renderFileSegmented(const juce::File &input, const juce::File &output,
+                             juce::ThreadPool &pool, const SegmentOptions &options) const;
+
+  const ChainDescription &getChain() const { return chain; }
+  int getBlockSize() const { return blockSize; }
+
+  //==============================================================================
+  static constexpr int defaultBlockSize = 512;
+
+private:
+  //==============================================================================
+  /** Fills the buffer with source audio starting at the given sample. */
+  using SourceReader = std::function<bool(juce::AudioBuffer<float> &, juce::int64 sourceStart)>;
+
+  /** Appends the first numSamples of the buffer to the output. */
+  using OutputWriter = std::function<bool(const juce::AudioBuffer<float> &, int numSamples)>;
+
+  bool renderSegments(int numChannels, juce::int64 length, double sampleRate,
+                      juce::ThreadPool &pool, const SegmentOptions &options,
+                      const juce::AudioChannelSet &channelLayout,
+                      const std::function<SourceReader()> &createSourceReader,
+                      const OutputWriter &write) const;
+
+  static std::unique_ptr<juce::AudioFormatReader> createReader(const juce::File &input, Result &result);
+  static std::unique_ptr<juce::AudioFormatWriter> createWriter(const juce::File &output, const juce::AudioFormatReader &reader,
+                                                               Result &result);
+
+  //==============================================================================
+  ChainDescription chain;
+  int blockSize;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OfflineRenderer)
+};
@@ -0,0 +1,150 @@
+/*
+  ==============================================================================
+
+    Chain stage that splits the signal into parallel branches, each its own
+    effect chain, and mixes them back together.
+
+  ==============================================================================
+*/
+
+#include "ParallelStage.h"
+#include "EffectChain.h"
+#include "RealtimeWatchdog.h"
+
+//==============================================================================
+ParallelStage::ParallelStage() = default;
+ParallelStage::~ParallelStage() = default;
+
+void ParallelStage::setBranches(const StageDescription &a, const StageDescription &b, float initialMorph)
+{
+    jassert(a.type == StageType::parallel && b.type == StageType::parallel);
+    jassert(a.branches != nullptr && b.branches != nullptr);
+
+    stageA = a;
+    stageB = b;
+    morph = initialMorph;
+}
+
+void ParallelStage::setChannelLayout(const juce::AudioChannelSet &layout)
+{
+    channelLayout = layout;
+}
+
+void ParallelStage::prepare(const juce::dsp::ProcessSpec &spec)
+{
+    // Prepared before: the branches keep their chains and buffers
+    if (!branches.empty())
+    {
+        for (auto &branch : branches)
+        {
+            if (branch.chain == nullptr)
+                continue;
+
+            branch.chain->prepare(spec, channelLayout);
+            branch.buffer.setSize(static_cast<int>(spec.numChannels), static_cast<int>(spec.maximumBlockSize), false, false, true);
+        }
+
+        return;
+    }
+
+    auto &branchesA = *stageA.branches;
+    auto &branchesB = *stageB.branches;
+    auto morphing = stageA.branches != stageB.branches;
+
+    branches.clear();
+    branches.resize(juce::jmax(branchesA.size(), branchesB.size()));
+    numBranchesWithStages = 0;
+
+    for (size_t i = 0; i < branches.size(); ++i)
+    {
+        auto &branch = branches[i];
+        auto *a = i < branchesA.size() ? &branchesA[i] : nullptr;
+        auto *b = i < branchesB.size() ? &branchesB[i] : nullptr;
+
+        // A branch missing at one end keeps its stages there but is silenced
+        branch.gainA = a != nullptr ? a->gain : 0.0f;
+        branch.gainB = b != nullptr ? b->gain : 0.0f;
+        branch.gain = branch.gainA + morph * (branch.gainB - branch.gainA);
+
+        ChainDescription descriptionA, descriptionB;
+        descriptionA.stages = (a != nullptr ? a : b)->stages;
+        descriptionB.stages = (b != nullptr ? b : a)->stages;
+
+        if (descriptionA.stages.empty() && descriptionB.stages.empty())
+            continue;
+
+        if (morphing)
+            branch.chain = std::make_unique<EffectChain>(descriptionA, descriptionB, morph, spec,
+                                                         EffectChain::FilterMode::minimumPhase, channelLayout);
+        else
+            branch.chain = std::make_unique<EffectChain>(descriptionA, spec, EffectChain::FilterMode::minimumPhase, channelLayout);
+
+        branch.buffer.setSize(static_cast<int>(spec.numChannels), static_cast<int>(spec.maximumBlockSize));
+        ++numBranchesWithStages;
+    }
+
+    // Branches with stages first, so the tasks are the first numBranchesWithStages
+    std::stable_partition(branches.begin(), branches.end(), [](const Branch &branch) { return branch.chain != nullptr; });
+}
+
+//==============================================================================
+void ParallelStage::process(const juce::dsp::ProcessContextReplacing<float> &context)
+{
+    SEMANTICEQ_RT_TAG("ParallelStage::process");
+
+    auto &block = context.getOutputBlock();
+    auto numSamples = block.getNumSamples();
+
+    for (int i = 0; i < numBranchesWithStages; ++i)
+    {
+        auto &branch = branches[(size_t)i];
+        branch.block = juce::dsp::AudioBlock<float>(branch.buffer).getSubBlock(0, numSamples);
+        branch.block.copyFrom(block);
+    }
+
+    if (numBranchesWithStages > 1 && numSamples >= (size_t)minParallelBlockSize)
+    {
+        workerPool->run(processBranch, this, numBranchesWithStages);
+    }
+    else
+    {
+        for (int i = 0; i < numBranchesWithStages; ++i)
+            processBranch(this, i);
+    }
+
+    // Dry branches all scale the input in place; the rest are added on top
+    auto dryGain = 0.0f;
+    for (auto i = (size_t)numBranchesWithStages; i < branches.size(); ++i)
+        dryGain += branches[i].gain;
+
+    block.multiplyBy(dryGain);
+
+    for (int i = 0; i < numBranchesWithStages; ++i)
+        block.addProductOf(branches[(size_t)i].block, branches[(size_t)i].gain);
+}
+
+void ParallelStage::processBranch(void *context, int index)
+{
+    auto &branch = static_cast<ParallelStage *>(context)->branches[(size_t)index];
+    branch.chain->process(branch.block);
+}
+
+void ParallelStage::reset()
+{
+    for (auto &branch : branches)
+        if (branch.chain != nullptr)
+            branch.chain->reset();
+}
+
+void ParallelStage::setMorph(float amount)
+{
+    morph = amount;
+
+    for (auto &branch : branches)
+    {
+        branch.gain = branch.gainA + amount * (branch.gainB - branch.gainA);
+
+        if (branch.chain != nullptr)
+            branch.chain->setMorphImmediately(amount);
+    }
+}
@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    Chain stage that splits the signal into parallel branches, each its own
+    effect chain, and mixes them back together.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChainDescription.h"
+#include "RealtimeWorkerPool.h"
+
+class EffectChain;
+
+//==============================================================================
+/**
+    Every branch gets a copy of the input and its output is added to the mix
+    at the branch's gain. A branch with no stages is the dry signal and costs
+    one multiply-add.
+
+    Branches are independent, so with blocks of at least minParallelBlockSize
+    samples and two or more branches with work to do, they are spread over
+    the RealtimeWorkerPool and the calling thread. Smaller blocks don't carry
+    the cost of the handoff and run on the calling thread.
+
+    For a morph, branch i of one end is paired with branch i of the other; a
+    branch present at only one end fades in or out through its gain.
+ */
+class ParallelStage
+{
+public:
+  ParallelStage();
+  ~ParallelStage();
+
+  /** Both ends of the morph; pass the same stage twice for no morph. Call before prepare(). */
+  void setBranches(const StageDescription &a, const StageDescription &b, float initialMorph);
+
+  /** Passed on to the branch chains. Call before prepare(). */
+  void setChannelLayout(const juce::AudioChannelSet &layout);
+
+  void prepare(const juce::dsp::ProcessSpec &spec);
+  void process(const juce::dsp::ProcessContextReplacing<float> &context);
+  void reset();
+
+  /** Audio thread. Moves every branch and its gain straight to the morph position. */
+  void setMorph(float amount);
+
+  //==============================================================================
+  static constexpr int minParallelBlockSize = 256;
+
+private:
+  //==============================================================================
+  struct Branch
+  {
+    std::unique_ptr<EffectChain> chain; // null for a dry branch
+    float gainA = 0.0f, gainB = 0.0f, gain = 0.0f;
+    juce::AudioBuffer<float> buffer;
+    juce::dsp::AudioBlock<float> block;
+  };
+
+  static void processBranch(void *context, int index);
+
+  //==============================================================================
+  StageDescription stageA, stageB;
+  float morph = 0.0f;
+  juce::AudioChannelSet channelLayout;
+
+  std::vector<Branch> branches;
+  int numBranchesWithStages = 0;
+
+  juce::SharedResourcePointer<RealtimeWorkerPool> workerPool;
+
+  JUCE_DECLARE_NON_COPYABLE(ParallelStage)
+};
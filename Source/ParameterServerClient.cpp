@@ -0,0 +1,237 @@
+/*
+  ==============================================================================
+
+    Minimal HTTP/1.1 client for the parameter server. Keeps one connection
+    open between queries instead of forking curl for each one.
+
+  ==============================================================================
+*/
+
+#include "ParameterServerClient.h"
+
+namespace
+{
+    constexpr size_t notFound = std::numeric_limits<size_t>::max();
+}
+
+//==============================================================================
+ParameterServerClient::ParameterServerClient()
+    : ParameterServerClient(Options())
+{
+}
+
+ParameterServerClient::ParameterServerClient(const Options &optionsIn)
+    : options(optionsIn),
+      buffer(initialBufferSize),
+      capacity(initialBufferSize)
+{
+}
+
+ParameterServerClient::~ParameterServerClient()
+{
+    disconnect();
+}
+
+//==============================================================================
+bool ParameterServerClient::post(const juce::String &jsonBody, juce::String &responseBody)
+{
+    auto body = jsonBody.toUTF8();
+    auto bodySize = body.sizeInBytes() - 1;
+
+    juce::MemoryOutputStream request;
+    request << "POST " << options.path << " HTTP/1.1\r\n"
+            << "Host: " << options.host << ":" << options.port << "\r\n"
+            << "Content-Type: application/json\r\n"
+            << "Content-Length: " << (int)bodySize << "\r\n"
+            << "Connection: keep-alive\r\n\r\n";
+    request.write(body.getAddress(), bodySize);
+
+    deadline = juce::Time::getMillisecondCounter() + (juce::uint32)juce::jmax(0, options.requestTimeoutMs);
+
+    // A kept-alive connection may have been closed by the server since the
+    // last request. That shows up as a failure before any response byte has
+    // arrived, so it is retried once on a fresh connection.
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        auto reused = isConnected();
+        if (!reused && !connect())
+            return false;
+
+        auto result = send(request.getMemoryBlock()) ? readResponse(responseBody) : ReadResult::closedBeforeResponse;
+        if (result == ReadResult::ok)
+            return true;
+
+        disconnect();
+        if (!reused || result != ReadResult::closedBeforeResponse)
+            return false;
+    }
+
+    return false;
+}
+
+void ParameterServerClient::disconnect()
+{
+    if (socket != nullptr)
+        socket->close();
+
+    socket.reset();
+}
+
+bool ParameterServerClient::isConnected() const
+{
+    return socket != nullptr && socket->isConnected();
+}
+
+//==============================================================================
+bool ParameterServerClient::connect()
+{
+    auto timeoutMs = juce::jmin(options.connectTimeoutMs, getRemainingMs());
+    if (timeoutMs <= 0)
+        return false;
+
+    socket = std::make_unique<juce::StreamingSocket>();
+    if (socket->connect(options.host, options.port, timeoutMs))
+        return true;
+
+    socket.reset();
+    return false;
+}
+
+bool ParameterServerClient::send(const juce::MemoryBlock &request)
+{
+    auto size = static_cast<int>(request.getSize());
+    return socket->write(request.getData(), size) == size;
+}
+
+int ParameterServerClient::receive()
+{
+    if (used == capacity)
+    {
+        capacity *= 2;
+        buffer.realloc(capacity);
+    }
+
+    auto timeoutMs = juce::jmin(options.readTimeoutMs, getRemainingMs());
+    if (timeoutMs <= 0 || socket->waitUntilReady(true, timeoutMs) != 1)
+        return -1;
+
+    auto numRead = socket->read(buffer + used, static_cast<int>(capacity - used), false);
+    if (numRead > 0)
+        used += (size_t)numRead;
+
+    return numRead;
+}
+
+int ParameterServerClient::getRemainingMs() const
+{
+    // The difference is signed, so it survives the counter wrapping around
+    return static_cast<int>(deadline - juce::Time::getMillisecondCounter());
+}
+
+size_t ParameterServerClient::find(const char *sequence, size_t from) const
+{
+    auto length = std::strlen(sequence);
+    for (auto i = from; i + length <= used; ++i)
+        if (std::memcmp(buffer + i, sequence, length) == 0)
+            return i;
+
+    return notFound;
+}
+
+ParameterServerClient::ReadResult ParameterServerClient::readResponse(juce::String &responseBody)
+{
+    used = 0;
+
+    size_t headerEnd;
+    while ((headerEnd = find("\r\n\r\n", 0)) == notFound)
+        if (receive() <= 0)
+            return used == 0 ? ReadResult::closedBeforeResponse : ReadResult::failed;
+
+    auto headerLines = juce::StringArray::fromLines(juce::String::fromUTF8(buffer, static_cast<int>(headerEnd)));
+    auto statusLine = juce::StringArray::fromTokens(headerLines[0], " ", {});
+    auto statusCode = statusLine[1].getIntValue();
+
+    // HTTP/1.1 connections stay open unless the server says otherwise
+    auto keepAlive = statusLine[0] == "HTTP/1.1";
+    auto chunked = false;
+    juce::int64 contentLength = -1;
+
+    for (int i = 1; i < headerLines.size(); ++i)
+    {
+        auto name = headerLines[i].upToFirstOccurrenceOf(":", false, false).trim();
+        auto value = headerLines[i].fromFirstOccurrenceOf(":", false, false).trim();
+
+        if (name.equalsIgnoreCase("Content-Length"))
+            contentLength = value.getLargeIntValue();
+        else if (name.equalsIgnoreCase("Transfer-Encoding"))
+            chunked = value.containsIgnoreCase("chunked");
+        else if (name.equalsIgnoreCase("Connection"))
+            keepAlive = value.equalsIgnoreCase("keep-alive");
+    }
+
+    auto bodyStart = headerEnd + 4;
+
+    if (chunked)
+    {
+        juce::MemoryOutputStream decoded;
+        auto position = bodyStart;
+
+        for (;;)
+        {
+            size_t lineEnd;
+            while ((lineEnd = find("\r\n", position)) == notFound)
+                if (receive() <= 0)
+                    return ReadResult::failed;
+
+            auto chunkSize = (size_t)juce::String::fromUTF8(buffer + position, static_cast<int>(lineEnd - position)).getHexValue64();
+            position = lineEnd + 2;
+
+            if (chunkSize == 0)
+            {
+                // Consume the blank line after the last chunk so it can't leak
+                // into the next response on this connection
+                while (find("\r\n", position) == notFound)
+                    if (receive() <= 0)
+                        return ReadResult::failed;
+                break;
+            }
+
+            while (used < position + chunkSize + 2)
+                if (receive() <= 0)
+                    return ReadResult::failed;
+
+            decoded.write(buffer + position, chunkSize);
+            position += chunkSize + 2;
+        }
+
+        responseBody = decoded.toUTF8();
+    }
+    else if (contentLength >= 0)
+    {
+        while (used < bodyStart + (size_t)contentLength)
+            if (receive() <= 0)
+                return ReadResult::failed;
+
+        responseBody = juce::String::fromUTF8(buffer + bodyStart, static_cast<int>(contentLength));
+    }
+    else
+    {
+        // No length given: the body runs until the server closes the
+        // connection. A timeout before then means the body is incomplete.
+        int numRead;
+        while ((numRead = receive()) > 0)
+        {
+        }
+
+        if (numRead < 0)
+            return ReadResult::failed;
+
+        keepAlive = false;
+        responseBody = juce::String::fromUTF8(buffer + bodyStart, static_cast<int>(used - bodyStart));
+    }
+
+    if (!keepAlive)
+        disconnect();
+
+    return statusCode == 200 ? ReadResult::ok : ReadResult::failed;
+}
@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    Minimal HTTP/1.1 client for the parameter server. Keeps one connection
+    open between queries instead of forking curl for each one.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Not thread safe: each client is meant to be owned and used by one worker
+    thread. The connection is reused for as long as the server keeps it alive;
+    a server that answers with HTTP/1.0 or "Connection: close" simply gets a
+    new connection per request. Responses are read straight into a buffer
+    that is kept between requests and only grows for unusually large replies.
+
+    readTimeoutMs limits each wait for more data, so on its own it can't stop
+    a server that keeps sending a byte at a time. Every post() therefore also
+    has an overall deadline, requestTimeoutMs, that covers connecting, the
+    retry and all of the reads.
+ */
+class ParameterServerClient
+{
+public:
+  struct Options
+  {
+    juce::String host = "127.0.0.1";
+    int port = 5000;
+    juce::String path = "/get-params";
+    int connectTimeoutMs = 2000;
+    int readTimeoutMs = 10000;
+    int requestTimeoutMs = 15000;
+  };
+
+  ParameterServerClient();
+  explicit ParameterServerClient(const Options &options);
+  ~ParameterServerClient();
+
+  //==============================================================================
+  /** Sends a JSON body and returns the response body for a 200 reply. */
+  bool post(const juce::String &jsonBody, juce::String &responseBody);
+
+  void disconnect();
+  bool isConnected() const;
+
+  const Options &getOptions() const { return options; }
+
+  static constexpr size_t initialBufferSize = 16384;
+
+private:
+  //==============================================================================
+  enum class ReadResult
+  {
+    ok,
+    closedBeforeResponse,
+    failed
+  };
+
+  bool connect();
+  bool send(const juce::MemoryBlock &request);
+  ReadResult readResponse(juce::String &responseBody);
+  int receive();
+  int getRemainingMs() const;
+  size_t find(const char *sequence, size_t from) const;
+
+  //==============================================================================
+  Options options;
+  std::unique_ptr<juce::StreamingSocket> socket;
+
+  juce::HeapBlock<char> buffer;
+  size_t capacity = 0, used = 0;
+  juce::uint32 deadline = 0;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParameterServerClient)
+};
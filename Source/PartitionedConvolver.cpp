@@ -0,0 +1,185 @@
+/*
+  ==============================================================================
+
+    Uniformly partitioned FFT convolution with a shared, pre-transformed
+    impulse response.
+
+  ==============================================================================
+*/
+
+#include "PartitionedConvolver.h"
+
+//==============================================================================
+void PartitionedConvolver::prepare(const PartitionedImpulseResponse &newResponse, int numChannels)
+{
+    jassert(newResponse.numChannels > 0);
+
+    response = &newResponse;
+    nextResponse = nullptr;
+
+    partitionSize = response->partitionSize;
+    numBins = response->numBins;
+    numPartitions = response->numPartitions;
+
+    if (fft == nullptr || fft->getSize() != 2 * partitionSize)
+        fft = std::make_unique<juce::dsp::FFT>(juce::roundToInt(std::log2(2 * partitionSize)));
+
+    // The FFT works in place on twice its size
+    scratch.assign((size_t)(4 * partitionSize), 0.0f);
+    accumulatorReal.assign((size_t)numBins, 0.0f);
+    accumulatorImag.assign((size_t)numBins, 0.0f);
+    fadeOutput.assign((size_t)partitionSize, 0.0f);
+
+    channels.resize((size_t)numChannels);
+    for (auto &channel : channels)
+    {
+        channel.input.assign((size_t)(2 * partitionSize), 0.0f);
+        channel.output.assign((size_t)partitionSize, 0.0f);
+        channel.spectraReal.assign((size_t)numPartitions * (size_t)numBins, 0.0f);
+        channel.spectraImag.assign((size_t)numPartitions * (size_t)numBins, 0.0f);
+    }
+
+    position = 0;
+    newestSpectrum = 0;
+}
+
+void PartitionedConvolver::reset()
+{
+    for (auto &channel : channels)
+    {
+        std::fill(channel.input.begin(), channel.input.end(), 0.0f);
+        std::fill(channel.output.begin(), channel.output.end(), 0.0f);
+        std::fill(channel.spectraReal.begin(), channel.spectraReal.end(), 0.0f);
+        std::fill(channel.spectraImag.begin(), channel.spectraImag.end(), 0.0f);
+    }
+
+    position = 0;
+    newestSpectrum = 0;
+}
+
+void PartitionedConvolver::crossfadeTo(const PartitionedImpulseResponse &next) noexcept
+{
+    // The delay line was sized for the prepared response
+    jassert(next.partitionSize == partitionSize && next.numPartitions <= numPartitions);
+
+    if (nextResponse == nullptr && &next != response)
+        nextResponse = &next;
+}
+
+//==============================================================================
+void PartitionedConvolver::process(const juce::dsp::AudioBlock<float> &block, float dryGain, float wetGain) noexcept
+{
+    auto numSamples = static_cast<int>(block.getNumSamples());
+    auto numChannels = juce::jmin(block.getNumChannels(), channels.size());
+
+    for (int start = 0; start < numSamples;)
+    {
+        auto count = juce::jmin(numSamples - start, partitionSize - position);
+
+        for (size_t c = 0; c < numChannels; ++c)
+        {
+            auto &channel = channels[c];
+            auto *samples = block.getChannelPointer(c) + start;
+
+            std::copy_n(samples, count, channel.input.data() + partitionSize + position);
+            juce::FloatVectorOperations::multiply(samples, dryGain, count);
+            juce::FloatVectorOperations::addWithMultiply(samples, channel.output.data() + position, wetGain, count);
+        }
+
+        start += count;
+        position += count;
+
+        if (position == partitionSize)
+        {
+            newestSpectrum = (newestSpectrum + 1) % numPartitions;
+
+            for (size_t c = 0; c < numChannels; ++c)
+                processPartition(channels[c], static_cast<int>(c));
+
+            if (nextResponse != nullptr)
+            {
+                response = nextResponse;
+                nextResponse = nullptr;
+            }
+
+            position = 0;
+        }
+    }
+}
+
+void PartitionedConvolver::processPartition(Channel &channel, int channelIndex) noexcept
+{
+    auto *data = scratch.data();
+
+    // Overlap-save: the previous partition and this one, transformed together
+    std::copy(channel.input.begin(), channel.input.end(), data);
+    std::fill(data + 2 * partitionSize, data + 4 * partitionSize, 0.0f);
+    fft->performRealOnlyForwardTransform(data, true);
+
+    auto *newestReal = channel.spectraReal.data() + (size_t)newestSpectrum * (size_t)numBins;
+    auto *newestImag = channel.spectraImag.data() + (size_t)newestSpectrum * (size_t)numBins;
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        newestReal[bin] = data[2 * bin];
+        newestImag[bin] = data[2 * bin + 1];
+    }
+
+    accumulate(channel, *response, channelIndex);
+    inverseTransform(channel.output.data());
+
+    if (nextResponse != nullptr)
+    {
+        accumulate(channel, *nextResponse, channelIndex);
+        inverseTransform(fadeOutput.data());
+
+        // Linear crossfade across the partition
+        for (int i = 0; i < partitionSize; ++i)
+        {
+            auto amount = (static_cast<float>(i) + 0.5f) / static_cast<float>(partitionSize);
+            channel.output[(size_t)i] += amount * (fadeOutput[(size_t)i] - channel.output[(size_t)i]);
+        }
+    }
+
+    std::copy(channel.input.begin() + partitionSize, channel.input.end(), channel.input.begin());
+}
+
+void PartitionedConvolver::accumulate(const Channel &channel, const PartitionedImpulseResponse &ir, int channelIndex) noexcept
+{
+    auto irChannel = channelIndex % ir.numChannels;
+    auto *accReal = accumulatorReal.data();
+    auto *accImag = accumulatorImag.data();
+    std::fill(accReal, accReal + numBins, 0.0f);
+    std::fill(accImag, accImag + numBins, 0.0f);
+
+    // Partition k of the response meets the input from k partitions ago
+    for (int k = 0; k < ir.numPartitions; ++k)
+    {
+        auto slot = (size_t)((newestSpectrum - k + numPartitions) % numPartitions);
+        auto *xr = channel.spectraReal.data() + slot * (size_t)numBins;
+        auto *xi = channel.spectraImag.data() + slot * (size_t)numBins;
+        auto *hr = ir.getReal(irChannel, k);
+        auto *hi = ir.getImag(irChannel, k);
+
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            accReal[bin] += xr[bin] * hr[bin] - xi[bin] * hi[bin];
+            accImag[bin] += xr[bin] * hi[bin] + xi[bin] * hr[bin];
+        }
+    }
+}
+
+void PartitionedConvolver::inverseTransform(float *destination) noexcept
+{
+    auto *data = scratch.data();
+
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        data[2 * bin] = accumulatorReal[(size_t)bin];
+        data[2 * bin + 1] = accumulatorImag[(size_t)bin];
+    }
+
+    fft->performRealOnlyInverseTransform(data);
+
+    // The first half wraps around; the second is this partition's output
+    std::copy(data + partitionSize, data + 2 * partitionSize, destination);
+}
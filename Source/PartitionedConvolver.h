@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    Uniformly partitioned FFT convolution with a shared, pre-transformed
+    impulse response.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ImpulseResponseCache.h"
+
+//==============================================================================
+/**
+    Overlap-save in the frequency domain: every partitionSize input samples
+    are transformed once into a delay line of spectra, and the output is the
+    sum of each past spectrum times the matching impulse response partition.
+    The cost per sample is fixed whatever the host's block size, and the
+    latency is the response's latencySamples (none for the built-in rooms at
+    the usual sample rates).
+
+    Channel c convolves with response channel c modulo its channel count.
+    The response is only read, never owned: the caller keeps it alive while
+    it is in use. Everything else is allocated in prepare().
+
+    crossfadeTo() switches to another response of the same shape on the
+    audio thread. Both are used for one partition, crossfading the outputs,
+    so the change is click-free and costs no more than one extra
+    multiply-add pass.
+ */
+class PartitionedConvolver
+{
+public:
+  void prepare(const PartitionedImpulseResponse &response, int numChannels);
+  void reset();
+
+  /** Adds wetGain times the convolution to the output after scaling it by dryGain, in place. */
+  void process(const juce::dsp::AudioBlock<float> &block, float dryGain, float wetGain) noexcept;
+
+  /**
+      Audio thread. Takes effect from the next partition boundary; until
+      then isCrossfading() is true and the old response is still read.
+      Ignored while a crossfade is already pending.
+   */
+  void crossfadeTo(const PartitionedImpulseResponse &next) noexcept;
+  bool isCrossfading() const noexcept { return nextResponse != nullptr; }
+
+  const PartitionedImpulseResponse *getResponse() const noexcept { return response; }
+  int getLatencySamples() const { return response != nullptr ? response->latencySamples : 0; }
+
+private:
+  //==============================================================================
+  struct Channel
+  {
+    std::vector<float> input;  // the last two partitions, oldest first
+    std::vector<float> output; // wet output for the partition being filled
+    std::vector<float> spectraReal, spectraImag; // delay line of input spectra, numPartitions deep
+  };
+
+  void processPartition(Channel &channel, int channelIndex) noexcept;
+  void accumulate(const Channel &channel, const PartitionedImpulseResponse &ir, int channelIndex) noexcept;
+  void inverseTransform(float *destination) noexcept;
+
+  //==============================================================================
+  const PartitionedImpulseResponse *response = nullptr;
+  const PartitionedImpulseResponse *nextResponse = nullptr;
+
+  std::unique_ptr<juce::dsp::FFT> fft;
+  std::vector<Channel> channels;
+  std::vector<float> scratch, accumulatorReal, accumulatorImag, fadeOutput;
+
+  int partitionSize = 0, numBins = 0, numPartitions = 0;
+  int position = 0; // samples into the current partition
+  int newestSpectrum = 0;
+};
@@ -16,27 +16,46 @@ SemanticEQAudioProcessorEditor::SemanticEQAudioProcessorEditor(SemanticEQAudioPr
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
     setSize(400, 300);
-    // eqInterpolationSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
-    // eqInterpolationSlider.setRange(-1.0, 1.0, 0.01);
-    // eqInterpolationSlider.setValue(0, juce::dontSendNotification);
-    // eqInterpolationSlider.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
-    // eqInterpolationSlider.addListener(this);
-    // addAndMakeVisible(eqInterpolationSlider);
-
-    // Initialize and configure text editor
-    textEditor.setMultiLine(false);
-    textEditor.setReturnKeyStartsNewLine(false);
-    textEditor.setReadOnly(false);
-    textEditor.setScrollbarsShown(true);
-    textEditor.setCaretVisible(true);
-    textEditor.setPopupMenuEnabled(true);
-    textEditor.setText("");
-    addAndMakeVisible(textEditor);
-
-    // Initialize and configure generate button
-    generateButton.setButtonText("Generate");
+    // Morphs from the chain generated for the first prompt (A) to the second (B)
+    eqInterpolationSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
+    eqInterpolationSlider.setRange(0.0, 1.0, 0.01);
+    eqInterpolationSlider.setValue(0, juce::dontSendNotification);
+    eqInterpolationSlider.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
+    eqInterpolationSlider.addListener(this);
+    addAndMakeVisible(eqInterpolationSlider);
+
+    // Initialize and configure text editors
+    for (auto *editor : {&textEditor, &morphTextEditor})
+    {
+        editor->setMultiLine(false);
+        editor->setReturnKeyStartsNewLine(false);
+        editor->setReadOnly(false);
+        editor->setScrollbarsShown(true);
+        editor->setCaretVisible(true);
+        editor->setPopupMenuEnabled(true);
+        editor->setText("");
+        addAndMakeVisible(editor);
+    }
+
+    // Initialize and configure generate buttons
+    generateButton.setButtonText("Generate A");
     generateButton.addListener(this);
     addAndMakeVisible(generateButton);
+
+    morphGenerateButton.setButtonText("Generate B");
+    morphGenerateButton.addListener(this);
+    addAndMakeVisible(morphGenerateButton);
+
+    linearPhaseToggle.setButtonText("Linear phase");
+    linearPhaseToggle.setToggleState(audioProcessor.isLinearPhase(), juce::dontSendNotification);
+    linearPhaseToggle.addListener(this);
+    addAndMakeVisible(linearPhaseToggle);
+
+    // Per-stage CPU cost of the playing chain, refreshed from the processor
+    profileLabel.setFont(juce::Font(juce::Font::getDefaultMonospacedFontName(), 11.0f, juce::Font::plain));
+    profileLabel.setJustificationType(juce::Justification::topLeft);
+    addAndMakeVisible(profileLabel);
+    startTimer(500);
 }
 
 SemanticEQAudioProcessorEditor::~SemanticEQAudioProcessorEditor()
@@ -59,9 +78,12 @@ void SemanticEQAudioProcessorEditor::resized()
     // subcomponents in your editor..
 
     auto area = getLocalBounds();
-    eqInterpolationSlider.setBounds(area);
     textEditor.setBounds(area.removeFromTop(20));
     generateButton.setBounds(area.removeFromTop(20));
+    morphTextEditor.setBounds(area.removeFromTop(20));
+    morphGenerateButton.setBounds(area.removeFromTop(20));
+    linearPhaseToggle.setBounds(area.removeFromTop(20));
+    profileLabel.setBounds(area.removeFromBottom(80));
     eqInterpolationSlider.setBounds(area);
 }
 
@@ -69,8 +91,28 @@ void SemanticEQAudioProcessorEditor::sliderValueChanged(juce::Slider *slider)
 {
     if (slider == &eqInterpolationSlider)
     {
-        // audioProcessor.setInterpolation(eqInterpolationSlider.getValue());
+        audioProcessor.setInterpolation(static_cast<float>(eqInterpolationSlider.getValue()));
+    }
+}
+
+void SemanticEQAudioProcessorEditor::timerCallback()
+{
+    auto profile = audioProcessor.getStageProfile();
+
+    juce::String text;
+    if (auto numEliminated = audioProcessor.getNumStagesEliminated(); numEliminated > 0)
+        text << numEliminated << (numEliminated == 1 ? " stage" : " stages") << " optimised away\n";
+
+    for (int i = 0; i < profile.numStages; ++i)
+    {
+        auto &stage = profile.stages[(size_t)i];
+        text << juce::String(stage.name).paddedRight(' ', 14) << " x" << stage.numDescribedStages
+             << "  mean " << juce::String(stage.meanMicroseconds, 1)
+             << " us  p99 " << juce::String(stage.p99Microseconds, 1)
+             << " us  max " << juce::String(stage.maxMicroseconds, 1) << " us\n";
     }
+
+    profileLabel.setText(text, juce::dontSendNotification);
 }
 
 void SemanticEQAudioProcessorEditor::buttonClicked(juce::Button *button)
@@ -80,4 +122,12 @@ void SemanticEQAudioProcessorEditor::buttonClicked(juce::Button *button)
         auto text = textEditor.getText();
         audioProcessor.processText(text);
     }
+    else if (button == &morphGenerateButton)
+    {
+        audioProcessor.processText(morphTextEditor.getText(), SemanticEQAudioProcessor::MorphSlot::b);
+    }
+    else if (button == &linearPhaseToggle)
+    {
+        audioProcessor.setLinearPhase(linearPhaseToggle.getToggleState());
+    }
 }
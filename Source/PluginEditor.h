@@ -16,7 +16,8 @@
 */
 class SemanticEQAudioProcessorEditor  : public juce::AudioProcessorEditor,
                                         public juce::Slider::Listener,
-                                        public juce::Button::Listener
+                                        public juce::Button::Listener,
+                                        private juce::Timer
 {
 public:
     SemanticEQAudioProcessorEditor (SemanticEQAudioProcessor&);
@@ -30,12 +31,18 @@ public:
 
 
 private:
+    void timerCallback() override;
+
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     SemanticEQAudioProcessor& audioProcessor;
     juce::Slider eqInterpolationSlider;
     juce::TextEditor textEditor;
     juce::TextButton generateButton;
+    juce::TextEditor morphTextEditor;
+    juce::TextButton morphGenerateButton;
+    juce::ToggleButton linearPhaseToggle;
+    juce::Label profileLabel;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SemanticEQAudioProcessorEditor)
 };
@@ -21,12 +21,14 @@ SemanticEQAudioProcessor::SemanticEQAudioProcessor()
 #endif
                          ),
 #endif
-      mainProcessor(new juce::AudioProcessorGraph())
+      queryWorker([this](const ChainDescription &chain, int tag) { applyChain(chain, static_cast<MorphSlot>(tag)); })
 {
 }
 
 SemanticEQAudioProcessor::~SemanticEQAudioProcessor()
 {
+    // The host has stopped calling processBlock by now
+    releaseAllChains();
 }
 
 //==============================================================================
@@ -64,7 +66,8 @@ bool SemanticEQAudioProcessor::isMidiEffect() const
 
 double SemanticEQAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // Of the most recently published chain
+    return tailLengthSeconds.load();
 }
 
 int SemanticEQAudioProcessor::getNumPrograms()
@@ -94,42 +97,42 @@ void SemanticEQAudioProcessor::changeProgramName(int index, const juce::String &
 //==============================================================================
 void SemanticEQAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
+    const juce::ScopedLock sl(chainLock);
+
     spec.sampleRate = sampleRate;
     spec.maximumBlockSize = samplesPerBlock;
     spec.numChannels = getTotalNumOutputChannels();
+    channelLayout = getChannelLayoutOfBus(false, 0);
 
-    mainProcessor->setPlayConfigDetails(getMainBusNumInputChannels(),
-                                        getMainBusNumOutputChannels(),
-                                        sampleRate, samplesPerBlock);
-
-    mainProcessor->prepareToPlay(sampleRate, samplesPerBlock);
-    initialiseGraph();
-}
+    fadeBuffer.setSize(juce::jmax(getTotalNumInputChannels(), getTotalNumOutputChannels()), samplesPerBlock, false, false, true);
 
-void SemanticEQAudioProcessor::initialiseGraph()
-{
-    mainProcessor->clear();
+    // processBlock isn't running, so the chains can be handled from here. A
+    // crossfade in progress is cut short and a pending chain or update is
+    // taken as the audio thread would have.
+    if (auto *next = pendingChain.exchange(nullptr))
+    {
+        reclaimer.retire(std::unique_ptr<EffectChain>(currentChain));
+        currentChain = next;
+    }
 
-    audioInputNode = mainProcessor->addNode(std::make_unique<juce::AudioProcessorGraph::AudioGraphIOProcessor>(juce::AudioProcessorGraph::AudioGraphIOProcessor::audioInputNode));
-    audioOutputNode = mainProcessor->addNode(std::make_unique<juce::AudioProcessorGraph::AudioGraphIOProcessor>(juce::AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode));
-    midiInputNode = mainProcessor->addNode(std::make_unique<juce::AudioProcessorGraph::AudioGraphIOProcessor>(juce::AudioProcessorGraph::AudioGraphIOProcessor::midiInputNode));
-    midiOutputNode = mainProcessor->addNode(std::make_unique<juce::AudioProcessorGraph::AudioGraphIOProcessor>(juce::AudioProcessorGraph::AudioGraphIOProcessor::midiOutputNode));
+    reclaimer.retire(std::unique_ptr<EffectChain>(fadingChain));
+    reclaimer.retire(std::unique_ptr<EffectChain>(unreleasedChain));
+    fadingChain = unreleasedChain = nullptr;
+    fadeLengthSamples = fadeSamplesRemaining = 0;
 
-    connectAudioNodes();
-    connectMidiNodes();
-}
+    takePendingUpdate();
 
-void SemanticEQAudioProcessor::connectAudioNodes()
-{
-    for (int channel = 0; channel < 2; ++channel)
-        mainProcessor->addConnection({{audioInputNode->nodeID, channel},
-                                      {audioOutputNode->nodeID, channel}});
-}
+    // The playing chain is kept, description and all, and only what depends
+    // on the spec is recomputed. It stays the target for in-place updates.
+    if (currentChain != nullptr)
+    {
+        currentChain->prepare(spec, channelLayout);
+        tailLengthSeconds = currentChain->getTailLengthSeconds();
+        setLatencySamples(currentChain->getLatencySamples());
+        return;
+    }
 
-void SemanticEQAudioProcessor::connectMidiNodes()
-{
-    mainProcessor->addConnection({{midiInputNode->nodeID, juce::AudioProcessorGraph::midiChannelIndex},
-                                  {midiOutputNode->nodeID, juce::AudioProcessorGraph::midiChannelIndex}});
+    rebuildChain();
 }
 
 void SemanticEQAudioProcessor::releaseResources()
@@ -145,11 +148,9 @@ bool SemanticEQAudioProcessor::isBusesLayoutSupported(const BusesLayout &layouts
     juce::ignoreUnused(layouts);
     return true;
 #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono() && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Every stage runs on any number of channels, so any layout from mono to
+    // 7.1.4 or higher-order ambisonics works as long as input matches output
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
         // This checks if the input layout matches the output layout
@@ -163,108 +164,149 @@ bool SemanticEQAudioProcessor::isBusesLayoutSupported(const BusesLayout &layouts
 }
 #endif
 
-void SemanticEQAudioProcessor::processText(const juce::String &text)
+void SemanticEQAudioProcessor::processText(const juce::String &text, MorphSlot slot)
 {
-    // Make API call to /get-params endpoint
-    std::string url = "http://localhost:5000/get-params";
-    std::string query = text.toStdString();
-    std::string command = "curl -X POST -H \"Content-Type: application/json\" -d '{\"query\": \"" + query + "\"}' " + url;
+    // The server round trip happens on the worker thread; applyChain() is
+    // called back on the message thread once the response has been parsed
+    queryWorker.submit(text, static_cast<int>(slot));
+}
 
-    // Execute the command and get the response
-    std::string response = "";
-    FILE *pipe = popen(command.c_str(), "r");
-    if (pipe)
+void SemanticEQAudioProcessor::applyChain(const ChainDescription &chain, MorphSlot slot)
+{
     {
-        char buffer[128];
-        while (!feof(pipe))
+        const juce::ScopedLock sl(chainLock);
+
+        if (slot == MorphSlot::a)
         {
-            if (fgets(buffer, 128, pipe) != NULL)
-                response += buffer;
+            chainA = chain;
+            hasChainA = true;
+        }
+        else
+        {
+            chainB = chain;
+            hasChainB = true;
         }
-        pclose(pipe);
     }
 
-    // Parse the JSON response
-    juce::var result = juce::JSON::parse(response);
-    if (result.isObject())
+    rebuildChain();
+}
+
+void SemanticEQAudioProcessor::rebuildChain()
+{
+    const juce::ScopedLock sl(chainLock);
+
+    if (spec.sampleRate <= 0.0 || !(hasChainA || hasChainB))
+        return;
+
+    auto filterMode = linearPhase.load() ? EffectChain::FilterMode::linearPhase : EffectChain::FilterMode::minimumPhase;
+
+    // With only chain B loaded, A is an empty chain, i.e. the dry signal
+    auto update = std::make_unique<EffectChain::ParameterUpdate>();
+    update->description = hasChainB && !hasChainA ? ChainDescription() : chainA;
+
+    if (hasChainB)
+    {
+        update->morphTarget = chainB;
+        EffectChain::alignForMorph(update->description, chainB, update->stagesA, update->stagesB);
+    }
+    else
     {
-        juce::var parameters = result;
-        // Print the parameters
-        // std::cout << "Parameters: " << parameters.toString() << std::endl;
+        update->stagesA = update->stagesB = chainA.stages;
+    }
 
-        // Set the parameters for each effect
-        if (parameters.isObject())
-        {
-            juce::var jsonEffects = parameters["effects"];
-            if (jsonEffects.isArray())
-            {
-                for (auto connection : mainProcessor->getConnections())
-                    mainProcessor->removeConnection(connection);
-
-                // Previous node to connect from, starting with the input node
-                juce::AudioProcessorGraph::Node::Ptr prevNode = audioInputNode;
-
-                 for (int i = 0; i < jsonEffects.size(); ++i)
-                 {
-                     juce::var effect = jsonEffects[i];
-
-                     if (effect.isObject())
-                     {
-                         juce::AudioProcessorGraph::Node::Ptr effectNode;
-                         juce::String effectName = effect["type"].toString();
-                         if (effectName == "peakFilter")
-                         {
-                            effectNode = mainProcessor->addNode(std::make_unique<FilterProcessor>("peakFilter", effect["centreFrequency"], effect["Q"], effect["gainFactor"]));
-                            // continue;
-                         } else if (effectName == "lowShelfFilter")
-                         {
-                            effectNode = mainProcessor->addNode(std::make_unique<FilterProcessor>("lowShelfFilter", effect["cutOffFrequency"], effect["Q"], effect["gainFactor"]));
-                            // continue;
-                         } else if (effectName == "highShelfFilter")
-                         {
-                            effectNode = mainProcessor->addNode(std::make_unique<FilterProcessor>("highShelfFilter", effect["cutOffFrequency"], effect["Q"], effect["gainFactor"]));
-                            // continue;
-                         } else if (effectName == "reverb")
-                         {
-                            effectNode = mainProcessor->addNode(std::make_unique<ReverbProcessor>(effect["roomSize"], effect["damping"], effect["wetLevel"], effect["width"]));
-                         } else if (effectName == "compressor")
-                         {
-                            effectNode = mainProcessor->addNode(std::make_unique<CompressorProcessor>(effect["threshold"], effect["ratio"], effect["attack"], effect["release"]));
-                            // continue;
-                         } else if (effectName == "delayLine")
-                         {
-                            effectNode = mainProcessor->addNode(std::make_unique<DelayLineProcessor>(effect["delay"], effect["maximumDelayInSamples"]));
-                            // continue;
-                         } else if (effectName == "phaser")
-                         {
-                            effectNode = mainProcessor->addNode(std::make_unique<PhaserProcessor>(effect["rate"], effect["depth"], effect["centerFrequency"], effect["feedback"], effect["mix"]));
-                            // continue;
-                         } else if (effectName == "chorus")
-                         {
-                            effectNode = mainProcessor->addNode(std::make_unique<ChorusProcessor>(effect["rate"], effect["depth"], effect["centreDelay"], effect["feedback"], effect["mix"]));
-                            // continue;
-                         }
-                         // Connect the previous node to this effect node
-                         for(int channel = 0; channel < 2; ++channel)
-                             mainProcessor->addConnection({ { prevNode->nodeID, channel }, { effectNode->nodeID, channel } });
-                         prevNode = effectNode;
-                     }
-                 }
-
-                // Connect the last effect to the output node
-                for (int channel = 0; channel < 2; ++channel)
-                    mainProcessor->addConnection({{prevNode->nodeID, channel}, {audioOutputNode->nodeID, channel}});
-                connectMidiNodes();
-
-                for (auto node : mainProcessor->getNodes()) // [10]
-                    node->getProcessor()->enableAllBuses();
-            }
-        }
+    // Same stages in the same places: the playing chain keeps its state and
+    // only ramps to the new parameters
+    if (activeChainId != 0 && activeMorphable == hasChainB && activeFilterMode == filterMode
+        && EffectChain::hasSameStructure(activeStagesA, update->stagesA)
+        && EffectChain::hasSameStructure(activeStagesB, update->stagesB))
+    {
+        update->chainId = activeChainId;
+        update->startStages.resize(update->stagesA.size());
+        activeStagesA = update->stagesA;
+        activeStagesB = update->stagesB;
+        publishUpdate(std::move(update));
+        return;
     }
+
+    // Otherwise build and prepare the whole chain here, then hand it over in one step
+    auto newChain = hasChainB ? std::make_unique<EffectChain>(update->description, chainB, interpolation.load(), spec,
+                                                              filterMode, channelLayout)
+                              : std::make_unique<EffectChain>(chainA, spec, filterMode, channelLayout);
+
+    activeChainId = newChain->getId();
+    activeStagesA = std::move(update->stagesA);
+    activeStagesB = std::move(update->stagesB);
+    activeMorphable = hasChainB;
+    activeFilterMode = filterMode;
+    publishChain(std::move(newChain));
+}
+
+void SemanticEQAudioProcessor::setLinearPhase(bool shouldBeLinearPhase)
+{
+    if (linearPhase.exchange(shouldBeLinearPhase) != shouldBeLinearPhase)
+        rebuildChain();
+}
+
+void SemanticEQAudioProcessor::setInterpolation(float amount)
+{
+    interpolation = juce::jlimit(0.0f, 1.0f, amount);
+}
+
+void SemanticEQAudioProcessor::publishChain(std::unique_ptr<EffectChain> newChain)
+{
+    tailLengthSeconds = newChain != nullptr ? newChain->getTailLengthSeconds() : 0.0;
+    setLatencySamples(newChain != nullptr ? newChain->getLatencySamples() : 0);
+
+    // A chain still pending here was never taken by the audio thread, so it
+    // can go straight to the reclaimer
+    std::unique_ptr<EffectChain> superseded(pendingChain.exchange(newChain.release()));
+    reclaimer.retire(std::move(superseded));
+}
+
+void SemanticEQAudioProcessor::publishUpdate(std::unique_ptr<EffectChain::ParameterUpdate> update)
+{
+    tailLengthSeconds = EffectChain::computeTailLengthSeconds(update->stagesA, update->stagesB, spec.sampleRate, activeFilterMode);
+
+    // An update the audio thread never took can be freed here; one it has
+    // taken only comes back through the finished queue
+    freeFinishedUpdates();
+    std::unique_ptr<EffectChain::ParameterUpdate> superseded(pendingUpdate.exchange(update.release()));
+}
+
+void SemanticEQAudioProcessor::freeFinishedUpdates()
+{
+    const auto scope = finishedUpdateFifo.read(finishedUpdateFifo.getNumReady());
+    scope.forEach([this](int index)
+                  { std::unique_ptr<EffectChain::ParameterUpdate> finished(finishedUpdates[(size_t)index]); });
+}
+
+void SemanticEQAudioProcessor::releaseAllChains()
+{
+    // Only called while the audio thread is stopped
+    reclaimer.retire(std::unique_ptr<EffectChain>(pendingChain.exchange(nullptr)));
+    reclaimer.retire(std::unique_ptr<EffectChain>(currentChain));
+    reclaimer.retire(std::unique_ptr<EffectChain>(fadingChain));
+    reclaimer.retire(std::unique_ptr<EffectChain>(unreleasedChain));
+
+    std::unique_ptr<EffectChain::ParameterUpdate> pending(pendingUpdate.exchange(nullptr));
+    freeFinishedUpdates();
+
+    currentChain = fadingChain = unreleasedChain = nullptr;
+    fadeLengthSamples = fadeSamplesRemaining = 0;
+
+    const juce::ScopedLock sl(chainLock);
+    activeChainId = 0;
+}
+
+void SemanticEQAudioProcessor::setCrossfadeTime(double seconds)
+{
+    crossfadeSeconds = juce::jlimit(0.0, maxCrossfadeSeconds, seconds);
 }
 
 void SemanticEQAudioProcessor::processBlock(juce::AudioBuffer<float> &buffer, juce::MidiBuffer &midiMessages)
 {
+    juce::ignoreUnused(midiMessages);
+    SEMANTICEQ_RT_SCOPE("processBlock");
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -272,9 +314,141 @@ void SemanticEQAudioProcessor::processBlock(juce::AudioBuffer<float> &buffer, ju
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear(i, 0, buffer.getNumSamples());
 
-    // juce::dsp::AudioBlock<float> block(buffer);
+    juce::dsp::AudioBlock<float> block(buffer);
+    processInOrder(block);
+}
+
+void SemanticEQAudioProcessor::processInOrder(juce::dsp::AudioBlock<float> &block)
+{
+    SEMANTICEQ_RT_TAG("processInOrder");
+    takePendingChain();
+    takePendingUpdate();
+
+    if (currentChain != nullptr)
+        currentChain->setMorph(interpolation.load());
+
+    auto numSamples = static_cast<int>(block.getNumSamples());
+    auto numChannels = block.getNumChannels();
+
+    if (fadeSamplesRemaining > 0 && numSamples <= fadeBuffer.getNumSamples() && numChannels <= (size_t)fadeBuffer.getNumChannels())
+    {
+        // Run the outgoing chain on a copy of the input, then ramp between the two
+        SEMANTICEQ_RT_TAG("crossfade");
+        auto outgoing = juce::dsp::AudioBlock<float>(fadeBuffer).getSubsetChannelBlock(0, numChannels).getSubBlock(0, (size_t)numSamples);
+        outgoing.copyFrom(block);
+
+        if (fadingChain != nullptr)
+            fadingChain->process(outgoing);
+        if (currentChain != nullptr)
+            currentChain->process(block, &profiler);
+
+        auto step = 1.0f / static_cast<float>(fadeLengthSamples);
+        auto startGain = static_cast<float>(fadeLengthSamples - fadeSamplesRemaining) * step;
+
+        for (size_t channel = 0; channel < numChannels; ++channel)
+        {
+            auto *incoming = block.getChannelPointer(channel);
+            auto *old = outgoing.getChannelPointer(channel);
+            auto gain = startGain;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                auto g = juce::jmin(gain, 1.0f);
+                incoming[i] = old[i] + g * (incoming[i] - old[i]);
+                gain += step;
+            }
+        }
+
+        fadeSamplesRemaining -= numSamples;
+        if (fadeSamplesRemaining <= 0)
+            finishCrossfade();
+
+        return;
+    }
+
+    // A block bigger than the prepared size can't be crossfaded; switch hard
+    if (fadeSamplesRemaining > 0)
+        finishCrossfade();
+
+    // Stages run in place one after another; with no chain the input passes through
+    if (currentChain != nullptr)
+        currentChain->process(block, &profiler);
+}
+
+void SemanticEQAudioProcessor::takePendingChain()
+{
+    SEMANTICEQ_RT_TAG("takePendingChain");
+
+    if (unreleasedChain != nullptr)
+    {
+        if (!reclaimer.retireFromAudioThread(unreleasedChain))
+            return;
+        unreleasedChain = nullptr;
+    }
+
+    // Starting a transition may retire two chains; leave the new one pending
+    // until the reclaimer has room for both
+    if (reclaimer.getFreeSpace() < 2 || pendingChain.load() == nullptr)
+        return;
+
+    auto *next = pendingChain.exchange(nullptr);
+    if (next == nullptr)
+        return;
 
-    mainProcessor->processBlock(buffer, midiMessages);
+    // At most one outgoing chain at a time keeps the double-processing window
+    // bounded: a chain that arrives mid-fade cuts the oldest one
+    if (fadeSamplesRemaining > 0)
+        releaseFromAudioThread(fadingChain);
+
+    fadingChain = currentChain;
+    currentChain = next;
+    fadeLengthSamples = fadeSamplesRemaining = static_cast<int>(crossfadeSeconds.load() * spec.sampleRate);
+
+    if (fadeLengthSamples <= 0)
+        finishCrossfade();
+}
+
+void SemanticEQAudioProcessor::takePendingUpdate()
+{
+    SEMANTICEQ_RT_TAG("takePendingUpdate");
+
+    // An update made for a chain that is still pending waits for it. The
+    // finished queue only fills up if the message thread stops draining it,
+    // and then the update stays pending rather than being lost.
+    if (pendingUpdate.load() == nullptr || pendingChain.load() != nullptr || finishedUpdateFifo.getFreeSpace() == 0)
+        return;
+
+    auto *update = pendingUpdate.exchange(nullptr);
+    if (update == nullptr)
+        return;
+
+    // Meant for a chain that has since been replaced, which was built with
+    // newer parameters anyway
+    if (currentChain != nullptr && currentChain->getId() == update->chainId)
+        currentChain->applyUpdate(*update);
+
+    // Single producer, and there was room above, so this always succeeds
+    const auto scope = finishedUpdateFifo.write(1);
+    scope.forEach([this, update](int index) { finishedUpdates[(size_t)index] = update; });
+}
+
+void SemanticEQAudioProcessor::finishCrossfade()
+{
+    releaseFromAudioThread(fadingChain);
+    fadingChain = nullptr;
+    fadeLengthSamples = fadeSamplesRemaining = 0;
+}
+
+void SemanticEQAudioProcessor::releaseFromAudioThread(EffectChain *chain)
+{
+    SEMANTICEQ_RT_TAG("releaseFromAudioThread");
+
+    if (!reclaimer.retireFromAudioThread(chain))
+    {
+        // Tried again at the start of every block until the queue drains
+        jassert(unreleasedChain == nullptr);
+        unreleasedChain = chain;
+    }
 }
 
 //==============================================================================
@@ -291,15 +465,68 @@ juce::AudioProcessorEditor *SemanticEQAudioProcessor::createEditor()
 //==============================================================================
 void SemanticEQAudioProcessor::getStateInformation(juce::MemoryBlock &destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    // The chains themselves are stored, not just the prompts, so restoring
+    // never needs the parameter server
+    juce::MemoryOutputStream output(destData, false);
+    output.writeInt(stateMagic);
+    output.writeByte(static_cast<char>(stateVersion));
+
+    const juce::ScopedLock sl(chainLock);
+    output.writeByte(static_cast<char>((hasChainA ? 1 : 0) | (hasChainB ? 2 : 0) | (linearPhase.load() ? 4 : 0)));
+    output.writeFloat(interpolation.load());
+
+    if (hasChainA)
+        chainA.writeBinary(output);
+    if (hasChainB)
+        chainB.writeBinary(output);
 }
 
 void SemanticEQAudioProcessor::setStateInformation(const void *data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    juce::MemoryInputStream input(data, (size_t)juce::jmax(0, sizeInBytes), false);
+
+    if (input.getNumBytesRemaining() < 10 || input.readInt() != stateMagic)
+        return;
+
+    auto version = static_cast<int>(input.readByte());
+    if (version < 1 || version > stateVersion)
+        return;
+
+    auto flags = input.readByte();
+    auto restoredInterpolation = input.readFloat();
+
+    ChainDescription restoredA, restoredB;
+    auto restoredHasA = (flags & 1) != 0;
+    auto restoredHasB = (flags & 2) != 0;
+
+    if ((restoredHasA && !ChainDescription::readBinary(input, restoredA))
+        || (restoredHasB && !ChainDescription::readBinary(input, restoredB)))
+        return;
+
+    // A query still in flight would overwrite the restored chain
+    queryWorker.cancelPending();
+
+    {
+        const juce::ScopedLock sl(chainLock);
+        chainA = std::move(restoredA);
+        chainB = std::move(restoredB);
+        hasChainA = restoredHasA;
+        hasChainB = restoredHasB;
+    }
+
+    setInterpolation(restoredInterpolation);
+    linearPhase = (flags & 4) != 0;
+
+    if (restoredHasA || restoredHasB)
+    {
+        rebuildChain();
+    }
+    else if (spec.sampleRate > 0.0)
+    {
+        const juce::ScopedLock sl(chainLock);
+        activeChainId = 0;
+        publishChain(std::make_unique<EffectChain>(ChainDescription(), spec, EffectChain::FilterMode::minimumPhase, channelLayout));
+    }
 }
 
 //==============================================================================
@@ -9,6 +9,12 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "BiquadDesign.h"
+#include "ChainDescription.h"
+#include "ChainReclaimer.h"
+#include "EffectChain.h"
+#include "QueryWorker.h"
+#include "RealtimeWatchdog.h"
 
 //==============================================================================
 /**
@@ -59,26 +65,26 @@ public:
   FilterProcessor(std::string type, float frequency, float Q, float gainFactor)
       : type(type), frequency(frequency), Q(Q), gainFactor(gainFactor)
   {
+    StageDescription::parseTypeName(type, stageType);
+
+    // Allocated once; prepareToPlay rewrites the coefficients in place
+    filter.coefficients = new juce::dsp::IIR::Coefficients<float>(1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f);
   }
 
   void prepareToPlay(double sampleRate, int samplesPerBlock) override
   {
-    juce::dsp::ProcessSpec spec{sampleRate, static_cast<juce::uint32>(samplesPerBlock), 2};
-    
-    juce::dsp::IIR::Coefficients<float>::Ptr coefficients;
-    if (type == "peakFilter")
-    {
-      coefficients = juce::dsp::IIR::Coefficients<float>::makePeakFilter(spec.sampleRate, frequency, Q, juce::Decibels::decibelsToGain(gainFactor));
-    }
-    else if (type == "lowShelfFilter")
-    {
-      coefficients = juce::dsp::IIR::Coefficients<float>::makeLowShelf(spec.sampleRate, frequency, Q, juce::Decibels::decibelsToGain(gainFactor));
-    }
-    else if (type == "highShelfFilter")
-    {
-      coefficients = juce::dsp::IIR::Coefficients<float>::makeHighShelf(spec.sampleRate, frequency, Q, juce::Decibels::decibelsToGain(gainFactor));
-    }
-    filter.coefficients = coefficients;
+    juce::dsp::ProcessSpec spec{sampleRate, static_cast<juce::uint32>(samplesPerBlock), static_cast<juce::uint32>(getTotalNumOutputChannels())};
+
+    BiquadCascade::Coefficients coefficients;
+    coefficientCache->getCoefficients(stageType, spec.sampleRate, frequency, Q, gainFactor, coefficients);
+
+    // Second-order coefficients are stored normalised as b0, b1, b2, a1, a2
+    auto *raw = filter.coefficients->getRawCoefficients();
+    raw[0] = coefficients.b0;
+    raw[1] = coefficients.b1;
+    raw[2] = coefficients.b2;
+    raw[3] = coefficients.a1;
+    raw[4] = coefficients.a2;
 
     filter.prepare(spec);
   }
@@ -100,6 +106,8 @@ public:
 private:
   juce::dsp::IIR::Filter<float> filter;
   juce::dsp::ProcessSpec spec;
+  juce::SharedResourcePointer<CoefficientCache> coefficientCache;
+  StageType stageType = StageType::peakFilter;
   std::string type;
   float frequency, Q, gainFactor;
 };
@@ -120,7 +128,7 @@ public:
 
   void prepareToPlay(double sampleRate, int samplesPerBlock) override
   {
-    juce::dsp::ProcessSpec spec{sampleRate, static_cast<juce::uint32>(samplesPerBlock), 2};
+    juce::dsp::ProcessSpec spec{sampleRate, static_cast<juce::uint32>(samplesPerBlock), static_cast<juce::uint32>(getTotalNumOutputChannels())};
     reverb.prepare(spec);
   }
 
@@ -158,7 +166,7 @@ public:
 
   void prepareToPlay(double sampleRate, int samplesPerBlock) override
   {
-    juce::dsp::ProcessSpec spec{sampleRate, static_cast<juce::uint32>(samplesPerBlock), 2};
+    juce::dsp::ProcessSpec spec{sampleRate, static_cast<juce::uint32>(samplesPerBlock), static_cast<juce::uint32>(getTotalNumOutputChannels())};
     compressor.prepare(spec);
   }
 
@@ -193,7 +201,7 @@ public:
 
   void prepareToPlay(double sampleRate, int samplesPerBlock) override
   {
-    juce::dsp::ProcessSpec spec{sampleRate, static_cast<juce::uint32>(samplesPerBlock), 2};
+    juce::dsp::ProcessSpec spec{sampleRate, static_cast<juce::uint32>(samplesPerBlock), static_cast<juce::uint32>(getTotalNumOutputChannels())};
     delayLine.prepare(spec);
   }
 
@@ -231,7 +239,7 @@ public:
 
   void prepareToPlay(double sampleRate, int samplesPerBlock) override
   {
-    juce::dsp::ProcessSpec spec{sampleRate, static_cast<juce::uint32>(samplesPerBlock), 2};
+    juce::dsp::ProcessSpec spec{sampleRate, static_cast<juce::uint32>(samplesPerBlock), static_cast<juce::uint32>(getTotalNumOutputChannels())};
     phaser.prepare(spec);
   }
 
@@ -269,7 +277,7 @@ public:
 
   void prepareToPlay(double sampleRate, int samplesPerBlock) override
   {
-    juce::dsp::ProcessSpec spec{sampleRate, static_cast<juce::uint32>(samplesPerBlock), 2};
+    juce::dsp::ProcessSpec spec{sampleRate, static_cast<juce::uint32>(samplesPerBlock), static_cast<juce::uint32>(getTotalNumOutputChannels())};
     chorus.prepare(spec);
   }
 
@@ -333,23 +341,119 @@ public:
   void setStateInformation(const void *data, int sizeInBytes) override;
 
   //==============================================================================
-  void initialiseGraph();
+  // Chains can be loaded into two slots and morphed between with setInterpolation()
+  enum class MorphSlot
+  {
+    a,
+    b
+  };
+
+  void processText(const juce::String &text, MorphSlot slot = MorphSlot::a);
+
+  void applyChain(const ChainDescription &chain, MorphSlot slot = MorphSlot::a);
+
+  /** 0 plays chain A, 1 plays chain B. Safe to call from any thread. */
+  void setInterpolation(float amount);
+
+  /** Hit and miss counters for repeated prompts. */
+  const ResponseCache &getResponseCache() const { return queryWorker.getCache(); }
+
+  /** Stages the optimiser removed from the last chain generated for the slot. Message thread. */
+  int getNumStagesEliminated(MorphSlot slot = MorphSlot::a) const { return queryWorker.getNumStagesEliminated(static_cast<int>(slot)); }
 
-  void connectAudioNodes();
+  /** Whether prompts go to the parameter server, the built-in presets, or both. */
+  void setQueryMode(QueryWorker::Mode mode) { queryWorker.setMode(mode); }
 
-  void connectMidiNodes();
-  
-  void processText(const juce::String &text);
+  /**
+      Linear-phase filtering: each run of filters becomes one FIR. Rebuilds
+      the chain and reports the added latency to the host. Message thread.
+   */
+  void setLinearPhase(bool shouldBeLinearPhase);
+  bool isLinearPhase() const { return linearPhase.load(); }
 
   void processInOrder(juce::dsp::AudioBlock<float> &block);
 
+  /** Per-stage cost of the playing chain over the last completed window. Any thread. */
+  StageProfiler::Snapshot getStageProfile() const { return profiler.getSnapshot(); }
+
+  /** Length of the crossfade between the outgoing and incoming chain. */
+  void setCrossfadeTime(double seconds);
+
+  // Bounds how long two chains are processed side by side
+  static constexpr double maxCrossfadeSeconds = 1.0;
+
+  // Plugin state: "SEQS", a version byte, then the chains (see getStateInformation).
+  // Version 2 added parallel stages; version 1 state reads unchanged.
+  static constexpr int stateMagic = 0x53514553;
+  static constexpr int stateVersion = 2;
+
 private:
+  //==============================================================================
+  void rebuildChain();
+  void publishChain(std::unique_ptr<EffectChain> newChain);
+  void publishUpdate(std::unique_ptr<EffectChain::ParameterUpdate> update);
+  void releaseAllChains();
+
+  void takePendingChain();
+  void takePendingUpdate();
+  void freeFinishedUpdates();
+  void finishCrossfade();
+  void releaseFromAudioThread(EffectChain *chain);
+
   //==============================================================================
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SemanticEQAudioProcessor)
-  std::unique_ptr<juce::AudioProcessorGraph> mainProcessor;
-  juce::AudioProcessorGraph::Node::Ptr audioInputNode;
-  juce::AudioProcessorGraph::Node::Ptr audioOutputNode;
-  juce::AudioProcessorGraph::Node::Ptr midiInputNode;
-  juce::AudioProcessorGraph::Node::Ptr midiOutputNode;
-  juce::dsp::ProcessSpec spec;
+  juce::dsp::ProcessSpec spec{};
+  juce::AudioChannelSet channelLayout;
+
+  // Never touched by the audio thread; the lock covers hosts that restore
+  // state or prepare on a thread other than the message thread
+  juce::CriticalSection chainLock;
+  ChainDescription chainA, chainB;
+  bool hasChainA = false, hasChainB = false;
+
+  // The aligned stages of the last chain published, or of the last update
+  // to it. A new description with the same structure updates that chain in
+  // place instead of replacing it.
+  juce::uint32 activeChainId = 0;
+  std::vector<StageDescription> activeStagesA, activeStagesB;
+  bool activeMorphable = false;
+  EffectChain::FilterMode activeFilterMode = EffectChain::FilterMode::minimumPhase;
+
+  std::atomic<float> interpolation{0.0f};
+  std::atomic<double> tailLengthSeconds{0.0};
+  std::atomic<bool> linearPhase{false};
+
+  // A prepared chain waiting for the audio thread, which takes it with a
+  // single exchange at the start of a block
+  std::atomic<EffectChain *> pendingChain{nullptr};
+
+  // Parameters for the current chain, taken the same way. Once applied an
+  // update holds the parameters it replaced; the audio thread hands it back
+  // through the finished queue and the message thread frees it.
+  std::atomic<EffectChain::ParameterUpdate *> pendingUpdate{nullptr};
+
+  static constexpr int finishedUpdateQueueSize = 16;
+  juce::AbstractFifo finishedUpdateFifo{finishedUpdateQueueSize};
+  std::array<EffectChain::ParameterUpdate *, finishedUpdateQueueSize> finishedUpdates{};
+
+  // Owned by the audio thread between prepareToPlay calls. During a crossfade
+  // fadingChain is the outgoing chain, or nullptr when fading in from dry.
+  EffectChain *currentChain = nullptr;
+  EffectChain *fadingChain = nullptr;
+  EffectChain *unreleasedChain = nullptr;
+  int fadeLengthSamples = 0;
+  int fadeSamplesRemaining = 0;
+  juce::AudioBuffer<float> fadeBuffer;
+  std::atomic<double> crossfadeSeconds{0.05};
+
+  // Fed by the audio thread for the current (incoming) chain only
+  StageProfiler profiler;
+
+  ChainReclaimer reclaimer;
+
+  QueryWorker queryWorker;
+
+#if SEMANTICEQ_RT_WATCHDOG
+  RealtimeWatchdog::LogReporter watchdogReporter;
+#endif
 };
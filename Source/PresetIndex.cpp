@@ -0,0 +1,169 @@
+/*
+  ==============================================================================
+
+    In-process text-to-chain lookup: a built-in table of preset descriptors,
+    embedded once and searched with a vectorised nearest-neighbour scan.
+
+  ==============================================================================
+*/
+
+#include "PresetIndex.h"
+#include "ResponseCache.h"
+
+namespace
+{
+    // Same effect schema as the parameter server's responses
+    const char *const presetTable = R"json([
+        {"descriptor": "warm smooth analog mellow rich cosy round",
+         "effects": [{"type": "lowShelfFilter", "cutOffFrequency": 200, "Q": 0.7, "gainFactor": 3},
+                     {"type": "highShelfFilter", "cutOffFrequency": 8000, "Q": 0.7, "gainFactor": -3}]},
+        {"descriptor": "bright crisp sparkle shiny brilliant",
+         "effects": [{"type": "peakFilter", "centreFrequency": 3000, "Q": 0.9, "gainFactor": 2},
+                     {"type": "highShelfFilter", "cutOffFrequency": 6000, "Q": 0.7, "gainFactor": 4}]},
+        {"descriptor": "dark muffled dull soft distant",
+         "effects": [{"type": "highShelfFilter", "cutOffFrequency": 4000, "Q": 0.7, "gainFactor": -6}]},
+        {"descriptor": "airy open breathy silky top end air",
+         "effects": [{"type": "highShelfFilter", "cutOffFrequency": 12000, "Q": 0.7, "gainFactor": 5}]},
+        {"descriptor": "clear clean remove mud muddy boxy",
+         "effects": [{"type": "peakFilter", "centreFrequency": 300, "Q": 1.2, "gainFactor": -4},
+                     {"type": "peakFilter", "centreFrequency": 500, "Q": 1.5, "gainFactor": -2}]},
+        {"descriptor": "telephone lo fi lofi radio old tinny",
+         "effects": [{"type": "lowShelfFilter", "cutOffFrequency": 400, "Q": 0.7, "gainFactor": -12},
+                     {"type": "highShelfFilter", "cutOffFrequency": 3000, "Q": 0.7, "gainFactor": -12},
+                     {"type": "peakFilter", "centreFrequency": 1500, "Q": 1.0, "gainFactor": 6}]},
+        {"descriptor": "punchy drums tight impact snappy",
+         "effects": [{"type": "peakFilter", "centreFrequency": 100, "Q": 1.0, "gainFactor": 3},
+                     {"type": "compressor", "threshold": -18, "ratio": 4, "attack": 10, "release": 100}]},
+        {"descriptor": "glue bus gentle compression cohesive",
+         "effects": [{"type": "compressor", "threshold": -12, "ratio": 2, "attack": 30, "release": 200}]},
+        {"descriptor": "vocal presence forward intelligible upfront",
+         "effects": [{"type": "peakFilter", "centreFrequency": 3000, "Q": 1.0, "gainFactor": 3},
+                     {"type": "highShelfFilter", "cutOffFrequency": 10000, "Q": 0.7, "gainFactor": 2},
+                     {"type": "compressor", "threshold": -20, "ratio": 3, "attack": 5, "release": 80}]},
+        {"descriptor": "boomy bass heavy deep fat thick low end",
+         "effects": [{"type": "lowShelfFilter", "cutOffFrequency": 120, "Q": 0.7, "gainFactor": 6}]},
+        {"descriptor": "thin light lean reduce bass",
+         "effects": [{"type": "lowShelfFilter", "cutOffFrequency": 250, "Q": 0.7, "gainFactor": -6}]},
+        {"descriptor": "harsh sibilant de ess tame edgy",
+         "effects": [{"type": "peakFilter", "centreFrequency": 6500, "Q": 2.0, "gainFactor": -5}]},
+        {"descriptor": "nasal honky",
+         "effects": [{"type": "peakFilter", "centreFrequency": 1000, "Q": 1.5, "gainFactor": -4}]},
+        {"descriptor": "spacious hall large big reverb wide ambient",
+         "effects": [{"type": "reverb", "roomSize": 0.85, "damping": 0.4, "wetLevel": 0.35, "width": 1.0}]},
+        {"descriptor": "small room intimate close ambience",
+         "effects": [{"type": "reverb", "roomSize": 0.3, "damping": 0.5, "wetLevel": 0.2, "width": 0.8}]},
+        {"descriptor": "dreamy shimmer ethereal lush chorus",
+         "effects": [{"type": "chorus", "rate": 0.8, "depth": 0.4, "centreDelay": 8, "feedback": 0.2, "mix": 0.5},
+                     {"type": "reverb", "roomSize": 0.7, "damping": 0.3, "wetLevel": 0.3, "width": 1.0}]},
+        {"descriptor": "psychedelic swirl swirling phaser sweep jet",
+         "effects": [{"type": "phaser", "rate": 0.5, "depth": 0.8, "centerFrequency": 1000, "feedback": 0.5, "mix": 0.5}]},
+        {"descriptor": "echo slapback delay rockabilly",
+         "effects": [{"type": "delayLine", "delay": 4800, "maximumDelayInSamples": 48000}]},
+        {"descriptor": "cathedral church huge realistic natural convolution",
+         "effects": [{"type": "convolutionReverb", "impulseResponse": "cathedral", "wetLevel": 0.35}]},
+        {"descriptor": "plate vocal smooth classic studio",
+         "effects": [{"type": "convolutionReverb", "impulseResponse": "plate", "wetLevel": 0.25}]},
+        {"descriptor": "parallel new york compression crushed smash drums",
+         "effects": [{"type": "parallel", "branches": [
+                         {"gain": 1.0, "effects": []},
+                         {"gain": 0.5, "effects": [{"type": "compressor", "threshold": -30, "ratio": 10, "attack": 1, "release": 60}]}]}]}
+    ])json";
+
+    juce::uint32 hashToken(const juce::String &token, juce::uint32 seed)
+    {
+        // FNV-1a over the UTF-8 bytes
+        auto h = 2166136261u ^ seed;
+        for (auto *p = token.toRawUTF8(); *p != 0; ++p)
+            h = (h ^ static_cast<juce::uint8>(*p)) * 16777619u;
+        return h;
+    }
+}
+
+//==============================================================================
+PresetIndex::PresetIndex()
+{
+    auto table = juce::JSON::parse(juce::String(presetTable));
+    jassert(table.isArray());
+
+    for (int i = 0; i < table.size(); ++i)
+    {
+        Preset preset;
+        preset.descriptor = table[i]["descriptor"].toString();
+        if (ChainDescription::fromJSON(table[i], preset.chain))
+            presets.push_back(preset);
+    }
+
+    embeddings.resize(presets.size() * (size_t)lanesPerRow);
+    for (size_t i = 0; i < presets.size(); ++i)
+        embed(presets[i].descriptor, embeddings.data() + i * (size_t)lanesPerRow);
+}
+
+//==============================================================================
+void PresetIndex::embed(const juce::String &text, Lanes *row)
+{
+    auto *values = reinterpret_cast<float *>(row);
+    std::fill(values, values + dimensions, 0.0f);
+
+    auto add = [values](const juce::String &token, float weight, juce::uint32 seed)
+    {
+        auto h = hashToken(token, seed);
+        // The top bit picks a sign so collisions tend to cancel out
+        values[h % (juce::uint32)dimensions] += (h & 0x80000000u) != 0 ? -weight : weight;
+    };
+
+    for (auto &word : juce::StringArray::fromTokens(ResponseCache::normaliseQuery(text), " ", {}))
+    {
+        add(word, 1.0f, 0);
+
+        auto padded = "#" + word + "#";
+        for (int i = 0; i + 3 <= padded.length(); ++i)
+            add(padded.substring(i, i + 3), 0.5f, 1);
+    }
+
+    auto norm = std::sqrt(dot(row, row));
+    if (norm > 0.0f)
+        for (int i = 0; i < dimensions; ++i)
+            values[i] /= norm;
+}
+
+float PresetIndex::dot(const Lanes *a, const Lanes *b) noexcept
+{
+    auto sum = a[0] * b[0];
+    for (int i = 1; i < lanesPerRow; ++i)
+        sum = sum + a[i] * b[i];
+
+#if JUCE_USE_SIMD
+    return sum.sum();
+#else
+    return sum;
+#endif
+}
+
+bool PresetIndex::findNearest(const juce::String &text, ChainDescription &chain, float *similarity) const
+{
+    std::array<Lanes, (size_t)lanesPerRow> query;
+    embed(text, query.data());
+
+    auto bestScore = -1.0f;
+    size_t best = 0;
+
+    for (size_t i = 0; i < presets.size(); ++i)
+    {
+        auto score = dot(query.data(), embeddings.data() + i * (size_t)lanesPerRow);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = i;
+        }
+    }
+
+    if (similarity != nullptr)
+        *similarity = bestScore;
+
+    if (presets.empty() || bestScore < minimumSimilarity)
+        return false;
+
+    chain = presets[best].chain;
+    chain.prompt = text;
+    return true;
+}
@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    In-process text-to-chain lookup: a built-in table of preset descriptors,
+    embedded once and searched with a vectorised nearest-neighbour scan.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChainDescription.h"
+
+//==============================================================================
+/**
+    Text is embedded by feature hashing its words and character trigrams into
+    a fixed-size, L2-normalised vector, so "warmer" still lands near "warm".
+    The preset embeddings are stored contiguously and the query is compared
+    with every row using SIMD dot products; with a few dozen presets a lookup
+    takes microseconds.
+
+    Built once per process; share it with juce::SharedResourcePointer.
+ */
+class PresetIndex
+{
+public:
+  PresetIndex();
+
+  //==============================================================================
+  /** Returns false if nothing in the table is similar enough to the text. */
+  bool findNearest(const juce::String &text, ChainDescription &chain, float *similarity = nullptr) const;
+
+  int getNumPresets() const { return static_cast<int>(presets.size()); }
+
+  //==============================================================================
+#if JUCE_USE_SIMD
+  using Lanes = juce::dsp::SIMDRegister<float>;
+  static constexpr int laneCount = static_cast<int>(Lanes::SIMDNumElements);
+#else
+  using Lanes = float;
+  static constexpr int laneCount = 1;
+#endif
+
+  static constexpr int dimensions = 256;
+  static constexpr int lanesPerRow = dimensions / laneCount;
+  static constexpr float minimumSimilarity = 0.2f;
+
+  static void embed(const juce::String &text, Lanes *row);
+
+private:
+  //==============================================================================
+  struct Preset
+  {
+    juce::String descriptor;
+    ChainDescription chain;
+  };
+
+  static float dot(const Lanes *a, const Lanes *b) noexcept;
+
+  std::vector<Preset> presets;
+  std::vector<Lanes> embeddings; // one row of lanesPerRow per preset
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PresetIndex)
+};
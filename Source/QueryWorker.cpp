@@ -0,0 +1,162 @@
+/*
+  ==============================================================================
+
+    Background worker that sends text queries to the parameter server (or the
+    local preset index) and hands the parsed effect chain back to the message
+    thread.
+
+  ==============================================================================
+*/
+
+#include "QueryWorker.h"
+
+//==============================================================================
+QueryWorker::QueryWorker(Completion onChainReadyIn, const ParameterServerClient::Options &serverOptions)
+    : juce::Thread("SemanticEQ query worker"),
+      onChainReady(std::move(onChainReadyIn)),
+      client(serverOptions)
+{
+    startThread();
+}
+
+QueryWorker::~QueryWorker()
+{
+    cancelPending();
+    signalThreadShouldExit();
+    wakeUp.signal();
+
+    // A request in flight finishes within the client's timeouts
+    auto &options = client.getOptions();
+    stopThread(options.connectTimeoutMs + options.readTimeoutMs + 1000);
+    cancelPendingUpdate();
+}
+
+//==============================================================================
+void QueryWorker::submit(const juce::String &query, int tag)
+{
+    jassert(juce::isPositiveAndBelow(tag, numTags));
+
+    {
+        const juce::ScopedLock sl(queueLock);
+        queue.push_back({query, tag, ++latestGeneration[(size_t)tag]});
+    }
+
+    wakeUp.signal();
+}
+
+void QueryWorker::cancelPending()
+{
+    const juce::ScopedLock sl(queueLock);
+    queue.clear();
+
+    for (auto &generation : latestGeneration)
+        ++generation;
+}
+
+//==============================================================================
+void QueryWorker::run()
+{
+    while (!threadShouldExit())
+    {
+        wakeUp.wait(-1);
+
+        for (;;)
+        {
+            Request request;
+            {
+                const juce::ScopedLock sl(queueLock);
+
+                // Everything queued before the newest query with the same tag is stale
+                queue.erase(std::remove_if(queue.begin(), queue.end(),
+                                           [this](const Request &r)
+                                           { return r.generation != latestGeneration[(size_t)r.tag].load(); }),
+                            queue.end());
+
+                if (queue.empty())
+                    break;
+
+                request = queue.front();
+                queue.pop_front();
+            }
+
+            ChainDescription chain;
+            auto tag = (size_t)request.tag;
+            auto currentMode = mode.load();
+
+            auto found = currentMode != Mode::local && queryServer(request.query, chain);
+
+            if (threadShouldExit())
+                return;
+
+            if (!found && currentMode != Mode::server)
+                found = presetIndex->findNearest(request.query, chain);
+
+            if (!found)
+                continue;
+
+            if (request.generation != latestGeneration[tag].load())
+                continue;
+
+            // After the cache, which keeps the chain as the server sent it
+            auto report = ChainOptimiser::optimise(chain);
+
+            {
+                const juce::ScopedLock sl(resultLock);
+                completedChains[tag] = std::move(chain);
+                completedGenerations[tag] = request.generation;
+                completedReports[tag] = report;
+            }
+
+            triggerAsyncUpdate();
+        }
+    }
+}
+
+void QueryWorker::handleAsyncUpdate()
+{
+    for (int tag = 0; tag < numTags; ++tag)
+    {
+        std::optional<ChainDescription> chain;
+        juce::uint32 generation;
+        ChainOptimiser::Report report;
+        {
+            const juce::ScopedLock sl(resultLock);
+            chain.swap(completedChains[(size_t)tag]);
+            generation = completedGenerations[(size_t)tag];
+            report = completedReports[(size_t)tag];
+        }
+
+        // Cancelled or superseded while the update was pending
+        if (!chain.has_value() || generation != latestGeneration[(size_t)tag].load())
+            continue;
+
+        numStagesEliminated[(size_t)tag] = report.getNumEliminated();
+
+        if (onChainReady != nullptr)
+            onChainReady(*chain, tag);
+    }
+}
+
+//==============================================================================
+bool QueryWorker::queryServer(const juce::String &query, ChainDescription &chain)
+{
+    if (cache->lookup(query, chain))
+        return true;
+
+    juce::String response;
+    if (!fetchResponse(query, response) || !ChainDescription::fromJSON(juce::JSON::parse(response), chain))
+        return false;
+
+    // Worth caching even if a newer query has made it stale
+    chain.prompt = query;
+    cache->insert(query, chain);
+    return true;
+}
+
+bool QueryWorker::fetchResponse(const juce::String &query, juce::String &response)
+{
+    auto *body = new juce::DynamicObject();
+    body->setProperty("query", query);
+
+    return client.post(juce::JSON::toString(juce::var(body), true), response);
+}
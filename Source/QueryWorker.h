@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+    Background worker that sends text queries to the parameter server and
+    hands the parsed effect chain back to the message thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChainDescription.h"
+#include "ChainOptimiser.h"
+#include "ParameterServerClient.h"
+#include "PresetIndex.h"
+#include "ResponseCache.h"
+
+//==============================================================================
+/**
+    Queries are queued and run one at a time on a background thread. Each query
+    carries a tag (for example the morph slot it is for); submitting a new query
+    makes every older one with the same tag stale. Queued stale queries are
+    dropped and a stale query that is already in flight has its result
+    discarded.
+
+    Every chain is run through ChainOptimiser before it is handed over, so
+    stages that do nothing are never built.
+
+    Responses are cached by normalised query text, so a repeated prompt is
+    answered without a network round trip. Depending on the mode, queries can
+    also be answered from the built-in PresetIndex, either always or only
+    when the server can't be reached.
+
+    The completion callback is always called on the message thread.
+ */
+class QueryWorker : private juce::Thread,
+                    private juce::AsyncUpdater
+{
+public:
+  using Completion = std::function<void(const ChainDescription &, int tag)>;
+
+  enum class Mode
+  {
+    server,
+    local,
+    serverWithLocalFallback
+  };
+
+  explicit QueryWorker(Completion onChainReady,
+                       const ParameterServerClient::Options &serverOptions = {});
+  ~QueryWorker() override;
+
+  //==============================================================================
+  void submit(const juce::String &query, int tag = 0);
+  void cancelPending();
+
+  /** Applies from the next query the worker starts. */
+  void setMode(Mode newMode) { mode = newMode; }
+  Mode getMode() const { return mode; }
+
+  const ResponseCache &getCache() const { return *cache; }
+
+  /** How many stages the optimiser removed from the last chain delivered for the tag. Message thread. */
+  int getNumStagesEliminated(int tag) const { return numStagesEliminated[(size_t)tag]; }
+
+  //==============================================================================
+  static constexpr int numTags = 2;
+
+private:
+  //==============================================================================
+  struct Request
+  {
+    juce::String query;
+    int tag = 0;
+    juce::uint32 generation = 0;
+  };
+
+  void run() override;
+  void handleAsyncUpdate() override;
+
+  bool fetchResponse(const juce::String &query, juce::String &response);
+  bool queryServer(const juce::String &query, ChainDescription &chain);
+
+  //==============================================================================
+  Completion onChainReady;
+  juce::SharedResourcePointer<ResponseCache> cache;
+  juce::SharedResourcePointer<PresetIndex> presetIndex;
+  std::atomic<Mode> mode{Mode::serverWithLocalFallback};
+
+  // Only used on the worker thread
+  ParameterServerClient client;
+
+  juce::CriticalSection queueLock;
+  std::deque<Request> queue;
+  juce::WaitableEvent wakeUp;
+  std::array<std::atomic<juce::uint32>, numTags> latestGeneration{};
+
+  juce::CriticalSection resultLock;
+  std::array<std::optional<ChainDescription>, numTags> completedChains;
+  std::array<juce::uint32, numTags> completedGenerations{};
+  std::array<ChainOptimiser::Report, numTags> completedReports{};
+
+  std::array<int, numTags> numStagesEliminated{};
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(QueryWorker)
+};
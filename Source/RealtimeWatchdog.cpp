@@ -0,0 +1,415 @@
+/*
+  ==============================================================================
+
+    Diagnostic build mode that catches real-time-unsafe calls on the audio
+    thread: heap allocations, lock acquisitions and blocking system calls.
+
+  ==============================================================================
+*/
+
+#include "RealtimeWatchdog.h"
+
+#if SEMANTICEQ_RT_WATCHDOG && JUCE_LINUX
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    using Violation = RealtimeWatchdog::Violation;
+
+    // Plain data so it is constant-initialised: touching it never allocates
+    struct ThreadState
+    {
+        int watchDepth = 0;
+        int numTags = 0;
+        const char *tags[RealtimeWatchdog::maxTagDepth] = {};
+        bool recording = false;
+    };
+
+    thread_local ThreadState threadState;
+
+    // Lets the hooks skip the thread-local lookup while nothing is watched
+    std::atomic<int> numWatchedScopes{0};
+
+    struct Slot
+    {
+        std::atomic<juce::uint64> sequence{0}; // index + 1 once written
+        Violation violation;
+    };
+
+    Slot slots[RealtimeWatchdog::logCapacity];
+    std::atomic<juce::uint64> writeCount{0}, readCount{0}, numDropped{0};
+    std::atomic<juce::uint64> violationCounts[RealtimeWatchdog::numViolationTypes]{};
+
+    void pushTag(const char *tag) noexcept
+    {
+        auto &state = threadState;
+        if (state.numTags < RealtimeWatchdog::maxTagDepth)
+            state.tags[state.numTags] = tag;
+        ++state.numTags;
+    }
+
+    void pushToLog(const Violation &violation) noexcept
+    {
+        auto index = writeCount.load(std::memory_order_relaxed);
+
+        // Claim a slot, or drop the record if the reader has fallen a whole log behind
+        do
+        {
+            if (index - readCount.load(std::memory_order_acquire) >= (juce::uint64)RealtimeWatchdog::logCapacity)
+            {
+                ++numDropped;
+                return;
+            }
+        } while (!writeCount.compare_exchange_weak(index, index + 1, std::memory_order_acq_rel));
+
+        auto &slot = slots[index % RealtimeWatchdog::logCapacity];
+        slot.violation = violation;
+        slot.sequence.store(index + 1, std::memory_order_release);
+    }
+}
+
+//==============================================================================
+RealtimeWatchdog::ScopedRealtime::ScopedRealtime(const char *tag) noexcept
+{
+    ++threadState.watchDepth;
+    ++numWatchedScopes;
+    pushTag(tag);
+}
+
+RealtimeWatchdog::ScopedRealtime::~ScopedRealtime() noexcept
+{
+    --threadState.numTags;
+    --numWatchedScopes;
+    --threadState.watchDepth;
+}
+
+RealtimeWatchdog::ScopedTag::ScopedTag(const char *tag) noexcept
+{
+    pushTag(tag);
+}
+
+RealtimeWatchdog::ScopedTag::~ScopedTag() noexcept
+{
+    --threadState.numTags;
+}
+
+//==============================================================================
+void RealtimeWatchdog::noteViolation(ViolationType type, const char *call) noexcept
+{
+    if (numWatchedScopes.load(std::memory_order_relaxed) == 0)
+        return;
+
+    auto &state = threadState;
+    if (state.watchDepth == 0 || state.recording)
+        return;
+
+    state.recording = true;
+
+    ++violationCounts[(int)type];
+
+    Violation violation;
+    violation.type = type;
+    violation.call = call;
+    violation.numTags = juce::jmin(state.numTags, maxTagDepth);
+    std::copy(state.tags, state.tags + violation.numTags, violation.tags.begin());
+    pushToLog(violation);
+
+    state.recording = false;
+}
+
+bool RealtimeWatchdog::isWatchingThisThread() noexcept
+{
+    return threadState.watchDepth > 0;
+}
+
+int RealtimeWatchdog::readViolations(Violation *destination, int maxViolations) noexcept
+{
+    auto index = readCount.load(std::memory_order_relaxed);
+    int numRead = 0;
+
+    while (numRead < maxViolations)
+    {
+        auto &slot = slots[index % logCapacity];
+        if (slot.sequence.load(std::memory_order_acquire) != index + 1)
+            break;
+
+        destination[numRead++] = slot.violation;
+        readCount.store(++index, std::memory_order_release);
+    }
+
+    return numRead;
+}
+
+juce::uint64 RealtimeWatchdog::getNumViolations(ViolationType type) noexcept
+{
+    return violationCounts[(int)type].load();
+}
+
+juce::uint64 RealtimeWatchdog::getNumDropped() noexcept
+{
+    return numDropped.load();
+}
+
+juce::String RealtimeWatchdog::describe(const Violation &violation)
+{
+    static const char *const typeNames[] = {"allocation", "deallocation", "lock", "system call"};
+
+    juce::StringArray tags;
+    for (int i = 0; i < violation.numTags; ++i)
+        tags.add(violation.tags[(size_t)i]);
+
+    return juce::String(typeNames[(int)violation.type]) + " (" + violation.call + ") in " + tags.joinIntoString(" > ");
+}
+
+void RealtimeWatchdog::LogReporter::timerCallback()
+{
+    Violation violations[64];
+
+    for (;;)
+    {
+        auto numRead = readViolations(violations, juce::numElementsInArray(violations));
+
+        for (int i = 0; i < numRead; ++i)
+            juce::Logger::writeToLog("Real-time violation: " + describe(violations[i]));
+
+        if (numRead < juce::numElementsInArray(violations))
+            break;
+    }
+}
+
+//==============================================================================
+#if SEMANTICEQ_RT_WATCHDOG
+
+// Replacing the global allocation functions is standard C++, so this part
+// works everywhere
+void *operator new(std::size_t size)
+{
+    RealtimeWatchdog::noteViolation(RealtimeWatchdog::ViolationType::allocation, "operator new");
+
+    if (auto *p = std::malloc(size == 0 ? 1 : size))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    RealtimeWatchdog::noteViolation(RealtimeWatchdog::ViolationType::allocation, "operator new[]");
+
+    if (auto *p = std::malloc(size == 0 ? 1 : size))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    RealtimeWatchdog::noteViolation(RealtimeWatchdog::ViolationType::allocation, "operator new");
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    RealtimeWatchdog::noteViolation(RealtimeWatchdog::ViolationType::allocation, "operator new[]");
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void *p) noexcept
+{
+    if (p != nullptr)
+        RealtimeWatchdog::noteViolation(RealtimeWatchdog::ViolationType::deallocation, "operator delete");
+
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    if (p != nullptr)
+        RealtimeWatchdog::noteViolation(RealtimeWatchdog::ViolationType::deallocation, "operator delete[]");
+
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept { operator delete(p); }
+void operator delete[](void *p, std::size_t) noexcept { operator delete[](p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { operator delete(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { operator delete[](p); }
+
+// The aligned forms, used for over-aligned types such as SIMD storage
+namespace
+{
+    void *allocateAligned(std::size_t size, std::align_val_t alignment) noexcept
+    {
+        auto bytes = size == 0 ? 1 : size;
+        auto align = juce::jmax(static_cast<std::size_t>(alignment), sizeof(void *));
+
+#if JUCE_WINDOWS
+        return _aligned_malloc(bytes, align);
+#else
+        void *p = nullptr;
+        return posix_memalign(&p, align, bytes) == 0 ? p : nullptr;
+#endif
+    }
+
+    void freeAligned(void *p) noexcept
+    {
+#if JUCE_WINDOWS
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    RealtimeWatchdog::noteViolation(RealtimeWatchdog::ViolationType::allocation, "operator new");
+
+    if (auto *p = allocateAligned(size, alignment))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    RealtimeWatchdog::noteViolation(RealtimeWatchdog::ViolationType::allocation, "operator new[]");
+
+    if (auto *p = allocateAligned(size, alignment))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    RealtimeWatchdog::noteViolation(RealtimeWatchdog::ViolationType::allocation, "operator new");
+    return allocateAligned(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    RealtimeWatchdog::noteViolation(RealtimeWatchdog::ViolationType::allocation, "operator new[]");
+    return allocateAligned(size, alignment);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+    if (p != nullptr)
+        RealtimeWatchdog::noteViolation(RealtimeWatchdog::ViolationType::deallocation, "operator delete");
+
+    freeAligned(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept
+{
+    if (p != nullptr)
+        RealtimeWatchdog::noteViolation(RealtimeWatchdog::ViolationType::deallocation, "operator delete[]");
+
+    freeAligned(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t alignment) noexcept { operator delete(p, alignment); }
+void operator delete[](void *p, std::size_t, std::align_val_t alignment) noexcept { operator delete[](p, alignment); }
+void operator delete(void *p, std::align_val_t alignment, const std::nothrow_t &) noexcept { operator delete(p, alignment); }
+void operator delete[](void *p, std::align_val_t alignment, const std::nothrow_t &) noexcept { operator delete[](p, alignment); }
+
+#if JUCE_LINUX
+
+namespace
+{
+    // Resolved lazily without function-local statics: their guards can take
+    // a mutex, which would recurse into the hook
+    template <typename Function>
+    Function findNext(std::atomic<Function> &cached, const char *name) noexcept
+    {
+        auto function = cached.load(std::memory_order_relaxed);
+        if (function == nullptr)
+        {
+            function = reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+            cached.store(function, std::memory_order_relaxed);
+        }
+        return function;
+    }
+
+    std::atomic<int (*)(pthread_mutex_t *)> realMutexLock{nullptr};
+    std::atomic<ssize_t (*)(int, void *, size_t)> realRead{nullptr};
+    std::atomic<ssize_t (*)(int, const void *, size_t)> realWrite{nullptr};
+    std::atomic<int (*)(int)> realClose{nullptr};
+    std::atomic<int (*)(const struct timespec *, struct timespec *)> realNanosleep{nullptr};
+    std::atomic<int (*)(useconds_t)> realUsleep{nullptr};
+    std::atomic<int (*)()> realSchedYield{nullptr};
+    std::atomic<void *(*)(void *, size_t, int, int, int, off_t)> realMmap{nullptr};
+    std::atomic<int (*)(void *, size_t)> realMunmap{nullptr};
+
+    void noteSystemCall(const char *call) noexcept
+    {
+        RealtimeWatchdog::noteViolation(RealtimeWatchdog::ViolationType::systemCall, call);
+    }
+}
+
+extern "C"
+{
+    int pthread_mutex_lock(pthread_mutex_t *mutex)
+    {
+        RealtimeWatchdog::noteViolation(RealtimeWatchdog::ViolationType::lock, "pthread_mutex_lock");
+        return findNext(realMutexLock, "pthread_mutex_lock")(mutex);
+    }
+
+    ssize_t read(int fd, void *buffer, size_t count)
+    {
+        noteSystemCall("read");
+        return findNext(realRead, "read")(fd, buffer, count);
+    }
+
+    ssize_t write(int fd, const void *buffer, size_t count)
+    {
+        noteSystemCall("write");
+        return findNext(realWrite, "write")(fd, buffer, count);
+    }
+
+    int close(int fd)
+    {
+        noteSystemCall("close");
+        return findNext(realClose, "close")(fd);
+    }
+
+    int nanosleep(const struct timespec *duration, struct timespec *remaining)
+    {
+        noteSystemCall("nanosleep");
+        return findNext(realNanosleep, "nanosleep")(duration, remaining);
+    }
+
+    int usleep(useconds_t microseconds)
+    {
+        noteSystemCall("usleep");
+        return findNext(realUsleep, "usleep")(microseconds);
+    }
+
+    int sched_yield()
+    {
+        noteSystemCall("sched_yield");
+        return findNext(realSchedYield, "sched_yield")();
+    }
+
+    void *mmap(void *address, size_t length, int protection, int flags, int fd, off_t offset)
+    {
+        noteSystemCall("mmap");
+        return findNext(realMmap, "mmap")(address, length, protection, flags, fd, offset);
+    }
+
+    int munmap(void *address, size_t length)
+    {
+        noteSystemCall("munmap");
+        return findNext(realMunmap, "munmap")(address, length);
+    }
+}
+
+#endif
+#endif
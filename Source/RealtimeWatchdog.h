@@ -0,0 +1,121 @@
+/*
+  ==============================================================================
+
+    Diagnostic build mode that catches real-time-unsafe calls on the audio
+    thread: heap allocations, lock acquisitions and blocking system calls.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// Off by default; set SEMANTICEQ_RT_WATCHDOG=1 in the project's preprocessor
+// definitions to build the hooks in.
+#ifndef SEMANTICEQ_RT_WATCHDOG
+#define SEMANTICEQ_RT_WATCHDOG 0
+#endif
+
+//==============================================================================
+/**
+    A thread is watched while it is inside a SEMANTICEQ_RT_SCOPE. Nested
+    SEMANTICEQ_RT_TAG scopes name where it currently is, and every violation
+    is recorded with that stack of tags.
+
+    With the watchdog built in:
+    - the global operator new/delete, aligned forms included, report
+      allocations on every platform;
+    - on Linux, pthread_mutex_lock and a set of blocking system calls are
+      interposed. That catches calls made from the plugin binary when it is
+      the executable (standalone, tools) or preloaded, but not from a plugin
+      loaded into a host with local symbol binding;
+    - locks the code takes itself (SpinLocks and the like) are reported
+      with SEMANTICEQ_RT_NOTE_LOCK.
+
+    Violations go into a fixed-size lock-free log that never allocates.
+    Any number of threads may record; one thread at a time may read.
+ */
+class RealtimeWatchdog
+{
+public:
+  enum class ViolationType : juce::uint8
+  {
+    allocation,
+    deallocation,
+    lock,
+    systemCall
+  };
+
+  static constexpr int numViolationTypes = 4;
+  static constexpr int maxTagDepth = 8;
+  static constexpr int logCapacity = 1024;
+
+  struct Violation
+  {
+    ViolationType type = ViolationType::allocation;
+    const char *call = nullptr; // what was caught, e.g. "operator new"
+    std::array<const char *, maxTagDepth> tags{};
+    int numTags = 0;
+  };
+
+  //==============================================================================
+  /** Watches the calling thread and pushes a tag until destroyed. Nests. */
+  class ScopedRealtime
+  {
+  public:
+    explicit ScopedRealtime(const char *tag) noexcept;
+    ~ScopedRealtime() noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE(ScopedRealtime)
+  };
+
+  /** Pushes a tag until destroyed. Tags are static strings. */
+  class ScopedTag
+  {
+  public:
+    explicit ScopedTag(const char *tag) noexcept;
+    ~ScopedTag() noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE(ScopedTag)
+  };
+
+  //==============================================================================
+  /** Records a violation if the calling thread is being watched. */
+  static void noteViolation(ViolationType type, const char *call) noexcept;
+
+  static bool isWatchingThisThread() noexcept;
+
+  /** Moves up to maxViolations out of the log and returns how many. */
+  static int readViolations(Violation *destination, int maxViolations) noexcept;
+
+  static juce::uint64 getNumViolations(ViolationType type) noexcept;
+  static juce::uint64 getNumDropped() noexcept;
+
+  static juce::String describe(const Violation &violation);
+
+  //==============================================================================
+  /** Drains the log on the message thread and writes it to the juce::Logger. */
+  class LogReporter : private juce::Timer
+  {
+  public:
+    LogReporter() { startTimer(500); }
+    ~LogReporter() override { stopTimer(); }
+
+  private:
+    void timerCallback() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LogReporter)
+  };
+};
+
+//==============================================================================
+#if SEMANTICEQ_RT_WATCHDOG
+#define SEMANTICEQ_RT_SCOPE(tag) const RealtimeWatchdog::ScopedRealtime JUCE_JOIN_MACRO(realtimeScope_, __LINE__)(tag)
+#define SEMANTICEQ_RT_TAG(tag) const RealtimeWatchdog::ScopedTag JUCE_JOIN_MACRO(realtimeTag_, __LINE__)(tag)
+#define SEMANTICEQ_RT_NOTE_LOCK(call) RealtimeWatchdog::noteViolation(RealtimeWatchdog::ViolationType::lock, call)
+#else
+#define SEMANTICEQ_RT_SCOPE(tag)
+#define SEMANTICEQ_RT_TAG(tag)
+#define SEMANTICEQ_RT_NOTE_LOCK(call)
+#endif
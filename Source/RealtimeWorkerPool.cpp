@@ -0,0 +1,183 @@
+/*
+  ==============================================================================
+
+    A small pool of high-priority threads that the audio thread can hand
+    independent pieces of one block to.
+
+  ==============================================================================
+*/
+
+#include "RealtimeWorkerPool.h"
+#include "RealtimeWatchdog.h"
+
+//==============================================================================
+RealtimeWorkerPool::Worker::Worker(RealtimeWorkerPool &ownerIn, int index)
+    : juce::Thread("SemanticEQ worker " + juce::String(index + 1)),
+      owner(ownerIn)
+{
+}
+
+void RealtimeWorkerPool::Worker::run()
+{
+    auto spinTicks = juce::Time::secondsToHighResolutionTicks(spinSeconds);
+
+    while (!threadShouldExit())
+    {
+        auto idleSince = juce::Time::getHighResolutionTicks();
+
+        while (!owner.helpWithBatches())
+        {
+            if (threadShouldExit())
+                return;
+
+            if (juce::Time::getHighResolutionTicks() - idleSince < spinTicks)
+            {
+                juce::Thread::yield();
+                continue;
+            }
+
+            // Checked again after announcing the sleep, so a batch published in
+            // between is never missed
+            sleeping = true;
+            if (!owner.hasWork())
+                wakeUp.wait(-1);
+
+            sleeping = false;
+            idleSince = juce::Time::getHighResolutionTicks();
+        }
+    }
+}
+
+//==============================================================================
+RealtimeWorkerPool::RealtimeWorkerPool()
+{
+    // Leaves a core for the host's own audio thread
+    auto numWorkers = juce::jlimit(0, maxWorkers, juce::SystemStats::getNumCpus() - 1);
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        auto *worker = workers.add(new Worker(*this, i));
+
+        if (worker->startRealtimeThread(juce::Thread::RealtimeOptions{}.withPriority(10)))
+            continue;
+
+        workersRealtime = false;
+        worker->startThread(juce::Thread::Priority::highest);
+    }
+
+    if (!workersRealtime)
+        juce::Logger::writeToLog("SemanticEQ: no real-time scheduling for the worker threads, using the highest normal priority");
+}
+
+RealtimeWorkerPool::~RealtimeWorkerPool()
+{
+    for (auto *worker : workers)
+    {
+        worker->signalThreadShouldExit();
+        worker->wakeUp.signal();
+    }
+
+    for (auto *worker : workers)
+        worker->stopThread(1000);
+}
+
+//==============================================================================
+void RealtimeWorkerPool::run(Task task, void *context, int numTasks) noexcept
+{
+    SEMANTICEQ_RT_TAG("RealtimeWorkerPool::run");
+
+    Batch batch;
+    batch.task = task;
+    batch.context = context;
+    batch.numTasks = numTasks;
+
+    Slot *slot = nullptr;
+    if (numTasks > 1 && !workers.isEmpty())
+    {
+        for (auto &candidate : slots)
+        {
+            Batch *expected = nullptr;
+            if (candidate.batch.compare_exchange_strong(expected, &batch))
+            {
+                slot = &candidate;
+                break;
+            }
+        }
+    }
+
+    // Too many callers at once: the batch still runs, just on this thread
+    if (slot == nullptr)
+    {
+        runTasks(batch);
+        return;
+    }
+
+    wakeSleepingWorkers();
+    runTasks(batch);
+
+    // Whatever is left is already running on a worker. Spins rather than
+    // yields: giving up the audio thread's time slice is worse than waiting.
+    while (batch.numFinished.load() < numTasks)
+    {
+    }
+
+    slot->batch = nullptr;
+
+    while (slot->numUsers.load() > 0)
+    {
+    }
+}
+
+void RealtimeWorkerPool::runTasks(Batch &batch) noexcept
+{
+    // Already watched on the calling thread; this covers the workers
+    SEMANTICEQ_RT_SCOPE("RealtimeWorkerPool task");
+
+    for (auto index = batch.nextTask.fetch_add(1); index < batch.numTasks; index = batch.nextTask.fetch_add(1))
+    {
+        batch.task(batch.context, index);
+        batch.numFinished.fetch_add(1);
+    }
+}
+
+bool RealtimeWorkerPool::helpWithBatches() noexcept
+{
+    auto helped = false;
+
+    for (auto &slot : slots)
+    {
+        if (slot.batch.load() == nullptr)
+            continue;
+
+        slot.numUsers.fetch_add(1);
+
+        if (auto *batch = slot.batch.load())
+        {
+            if (batch->nextTask.load() < batch->numTasks)
+            {
+                runTasks(*batch);
+                helped = true;
+            }
+        }
+
+        slot.numUsers.fetch_sub(1);
+    }
+
+    return helped;
+}
+
+bool RealtimeWorkerPool::hasWork() const noexcept
+{
+    for (auto &slot : slots)
+        if (slot.batch.load() != nullptr)
+            return true;
+
+    return false;
+}
+
+void RealtimeWorkerPool::wakeSleepingWorkers() noexcept
+{
+    for (auto *worker : workers)
+        if (worker->sleeping.load())
+            worker->wakeUp.signal();
+}
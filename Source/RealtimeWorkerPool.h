@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    A small pool of high-priority threads that the audio thread can hand
+    independent pieces of one block to.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    run() spreads a batch of tasks over the workers and the calling thread,
+    and returns once all of them have finished. The caller works through the
+    batch too, so a batch always completes even if no worker wakes up in
+    time, and nothing is ever queued behind a blocked thread.
+
+    Tasks are claimed one at a time from a shared counter, so a worker that
+    finishes early takes the next task instead of idling. Up to
+    maxConcurrentBatches callers (one per plugin instance's audio thread) can
+    run batches at once; beyond that run() simply executes the batch itself.
+
+    Idle workers spin briefly and then sleep. Waking a sleeping worker means
+    signalling a WaitableEvent, which takes a short uncontended lock; this
+    only happens for the first batch after an idle gap.
+
+    The caller waits without limit for tasks a worker has already claimed,
+    so workers are started in the OS's real-time class, like an audio
+    thread. Where that isn't allowed (Linux without rtprio, for one) they
+    fall back to the highest normal priority, and a worker preempted
+    mid-task holds the audio thread up until it is scheduled again;
+    areWorkersRealtime() reports which it is. Tasks run inside a
+    SEMANTICEQ_RT_SCOPE on every thread, so the watchdog sees what they do.
+
+    Shared across the process; use it through juce::SharedResourcePointer.
+ */
+class RealtimeWorkerPool
+{
+public:
+  using Task = void (*)(void *context, int taskIndex);
+
+  RealtimeWorkerPool();
+  ~RealtimeWorkerPool();
+
+  //==============================================================================
+  /** Runs task(context, i) for every i in [0, numTasks). Never allocates. */
+  void run(Task task, void *context, int numTasks) noexcept;
+
+  int getNumWorkers() const { return workers.size(); }
+
+  /** False if any worker had to fall back to a normal priority. */
+  bool areWorkersRealtime() const { return workersRealtime; }
+
+  //==============================================================================
+  static constexpr int maxWorkers = 3;
+  static constexpr int maxConcurrentBatches = 16;
+  static constexpr double spinSeconds = 0.0002;
+
+private:
+  //==============================================================================
+  struct Batch
+  {
+    Task task = nullptr;
+    void *context = nullptr;
+    int numTasks = 0;
+    std::atomic<int> nextTask{0}, numFinished{0};
+  };
+
+  // A worker counts itself in as a user before it reads the batch pointer,
+  // so the caller knows when no worker can still be touching its batch.
+  struct Slot
+  {
+    std::atomic<Batch *> batch{nullptr};
+    std::atomic<int> numUsers{0};
+  };
+
+  class Worker : public juce::Thread
+  {
+  public:
+    Worker(RealtimeWorkerPool &owner, int index);
+
+    void run() override;
+
+    juce::WaitableEvent wakeUp;
+    std::atomic<bool> sleeping{false};
+
+  private:
+    RealtimeWorkerPool &owner;
+  };
+
+  //==============================================================================
+  static void runTasks(Batch &batch) noexcept;
+  bool helpWithBatches() noexcept;
+  bool hasWork() const noexcept;
+  void wakeSleepingWorkers() noexcept;
+
+  //==============================================================================
+  std::array<Slot, maxConcurrentBatches> slots;
+  juce::OwnedArray<Worker> workers;
+  bool workersRealtime = true;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RealtimeWorkerPool)
+};
@@ -0,0 +1,150 @@
+/*
+  ==============================================================================
+
+    Cache of parsed server responses, keyed on normalised query text. Kept in
+    memory as an LRU list and mirrored to a file so it survives restarts.
+
+  ==============================================================================
+*/
+
+#include "ResponseCache.h"
+
+//==============================================================================
+ResponseCache::ResponseCache()
+    : ResponseCache(getDefaultCacheFile())
+{
+}
+
+ResponseCache::ResponseCache(const juce::File &cacheFile)
+    : file(cacheFile)
+{
+    load();
+}
+
+juce::File ResponseCache::getDefaultCacheFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("SemanticEQ")
+        .getChildFile("ResponseCache.json");
+}
+
+juce::String ResponseCache::normaliseQuery(const juce::String &query)
+{
+    juce::String cleaned;
+    for (auto character : query.toLowerCase())
+        cleaned << (juce::CharacterFunctions::isLetterOrDigit(character) ? character : (juce::juce_wchar)' ');
+
+    return juce::StringArray::fromTokens(cleaned, " ", {}).joinIntoString(" ");
+}
+
+//==============================================================================
+bool ResponseCache::lookup(const juce::String &query, ChainDescription &chain)
+{
+    auto key = normaliseQuery(query);
+
+    const juce::ScopedLock sl(lock);
+    auto found = index.find(key);
+    if (found == index.end())
+    {
+        ++misses;
+        return false;
+    }
+
+    entries.splice(entries.begin(), entries, found->second);
+    chain = found->second->chain;
+    chain.prompt = query;
+    ++hits;
+    return true;
+}
+
+void ResponseCache::insert(const juce::String &query, const ChainDescription &chain)
+{
+    auto key = normaliseQuery(query);
+
+    const juce::ScopedLock sl(lock);
+    auto found = index.find(key);
+    if (found != index.end())
+    {
+        found->second->chain = chain;
+        entries.splice(entries.begin(), entries, found->second);
+    }
+    else
+    {
+        entries.push_front({key, chain});
+        index[key] = entries.begin();
+
+        if ((int)entries.size() > capacity)
+        {
+            index.erase(entries.back().key);
+            entries.pop_back();
+        }
+    }
+
+    save();
+}
+
+void ResponseCache::clear()
+{
+    const juce::ScopedLock sl(lock);
+    entries.clear();
+    index.clear();
+    save();
+}
+
+int ResponseCache::getNumEntries() const
+{
+    const juce::ScopedLock sl(lock);
+    return static_cast<int>(entries.size());
+}
+
+//==============================================================================
+void ResponseCache::load()
+{
+    auto json = juce::JSON::parse(file);
+    if (!json.isObject() || static_cast<int>(json["version"]) != fileVersion)
+        return;
+
+    auto jsonEntries = json["entries"];
+    if (!jsonEntries.isArray())
+        return;
+
+    const juce::ScopedLock sl(lock);
+
+    // Stored most recently used first
+    for (int i = 0; i < jsonEntries.size() && (int)entries.size() < capacity; ++i)
+    {
+        auto jsonEntry = jsonEntries[i];
+        auto key = normaliseQuery(jsonEntry["query"].toString());
+
+        ChainDescription chain;
+        if (key.isEmpty() || index.count(key) != 0 || !ChainDescription::fromJSON(jsonEntry["response"], chain))
+            continue;
+
+        chain.prompt = jsonEntry["query"].toString();
+        entries.push_back({key, chain});
+        index[key] = std::prev(entries.end());
+    }
+}
+
+void ResponseCache::save() const
+{
+    juce::Array<juce::var> jsonEntries;
+    for (auto &entry : entries)
+    {
+        auto *jsonEntry = new juce::DynamicObject();
+        jsonEntry->setProperty("query", entry.chain.prompt.isNotEmpty() ? entry.chain.prompt : entry.key);
+        jsonEntry->setProperty("response", entry.chain.toJSON());
+        jsonEntries.add(juce::var(jsonEntry));
+    }
+
+    auto *json = new juce::DynamicObject();
+    json->setProperty("version", fileVersion);
+    json->setProperty("entries", jsonEntries);
+
+    // Written to a temporary file and moved into place, so a crash never
+    // leaves a half-written cache behind
+    file.getParentDirectory().createDirectory();
+    juce::TemporaryFile temp(file);
+    if (temp.getFile().replaceWithText(juce::JSON::toString(juce::var(json))))
+        temp.overwriteTargetFileWithTemporary();
+}
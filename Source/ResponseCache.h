@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    Cache of parsed server responses, keyed on normalised query text. Kept in
+    memory as an LRU list and mirrored to a file so it survives restarts.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChainDescription.h"
+
+//==============================================================================
+/**
+    Shared by every plugin instance in the process; get it through
+    juce::SharedResourcePointer<ResponseCache>. All methods are thread safe,
+    but lookups and inserts take a lock and insert() writes the cache file, so
+    neither belongs on the audio or message thread.
+ */
+class ResponseCache
+{
+public:
+  ResponseCache();
+  explicit ResponseCache(const juce::File &cacheFile);
+
+  //==============================================================================
+  bool lookup(const juce::String &query, ChainDescription &chain);
+  void insert(const juce::String &query, const ChainDescription &chain);
+  void clear();
+
+  juce::int64 getNumHits() const { return hits.load(); }
+  juce::int64 getNumMisses() const { return misses.load(); }
+  int getNumEntries() const;
+
+  /** Lower case, punctuation stripped, whitespace collapsed. */
+  static juce::String normaliseQuery(const juce::String &query);
+
+  static juce::File getDefaultCacheFile();
+
+  //==============================================================================
+  static constexpr int capacity = 256;
+  static constexpr int fileVersion = 1;
+
+private:
+  //==============================================================================
+  struct Entry
+  {
+    juce::String key;
+    ChainDescription chain;
+  };
+
+  struct KeyHash
+  {
+    size_t operator()(const juce::String &key) const noexcept { return static_cast<size_t>(key.hash()); }
+  };
+
+  void load();
+  void save() const;
+
+  //==============================================================================
+  juce::File file;
+
+  juce::CriticalSection lock;
+  std::list<Entry> entries; // most recently used first
+  std::unordered_map<juce::String, std::list<Entry>::iterator, KeyHash> index;
+
+  std::atomic<juce::int64> hits{0}, misses{0};
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ResponseCache)
+};
@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    Per-stage CPU accounting for the compiled effect chain, published to other
+    threads as lock-free snapshots.
+
+  ==============================================================================
+*/
+
+#include "StageProfiler.h"
+#include "EffectChain.h"
+
+//==============================================================================
+void StageProfiler::startBlock(const EffectChain &chain) noexcept
+{
+    if (chain.getId() != chainId)
+    {
+        chainId = chain.getId();
+        numStages = juce::jmin(chain.getNumStages(), maxStages);
+
+        for (int i = 0; i < numStages; ++i)
+        {
+            stageInfo[(size_t)i].name = chain.getStageName(i);
+            stageInfo[(size_t)i].numDescribedStages = chain.getNumDescribedStages(i);
+        }
+
+        resetWindow();
+    }
+
+    std::fill(blockTicks.begin(), blockTicks.begin() + numStages, 0);
+}
+
+void StageProfiler::addStageTicks(int stage, juce::int64 ticks) noexcept
+{
+    if (stage < numStages)
+        blockTicks[(size_t)stage] += ticks;
+}
+
+void StageProfiler::endBlock() noexcept
+{
+    for (size_t i = 0; i < (size_t)numStages; ++i)
+    {
+        auto nanoseconds = static_cast<double>(blockTicks[i]) * nanosecondsPerTick;
+
+        totalNanoseconds[i] += nanoseconds;
+        maxNanoseconds[i] = juce::jmax(maxNanoseconds[i], nanoseconds);
+        ++histograms[i][(size_t)getBucket(nanoseconds)];
+    }
+
+    if (++numBlocks >= windowBlocks)
+    {
+        publish();
+        resetWindow();
+    }
+}
+
+//==============================================================================
+StageProfiler::Snapshot StageProfiler::getSnapshot() const
+{
+    const juce::SpinLock::ScopedLockType sl(readLock);
+
+    if ((latestIndex.load(std::memory_order_acquire) & freshBit) != 0)
+        frontIndex = latestIndex.exchange(frontIndex, std::memory_order_acq_rel) & ~freshBit;
+
+    return snapshots[(size_t)frontIndex];
+}
+
+//==============================================================================
+void StageProfiler::resetWindow() noexcept
+{
+    numBlocks = 0;
+
+    for (size_t i = 0; i < (size_t)maxStages; ++i)
+    {
+        totalNanoseconds[i] = maxNanoseconds[i] = 0.0;
+        histograms[i].fill(0);
+    }
+}
+
+void StageProfiler::publish() noexcept
+{
+    auto &snapshot = snapshots[(size_t)backIndex];
+    snapshot.chainId = chainId;
+    snapshot.numStages = numStages;
+    snapshot.numBlocks = numBlocks;
+
+    auto p99Rank = static_cast<juce::uint32>(std::ceil(0.99 * numBlocks));
+
+    for (size_t i = 0; i < (size_t)numStages; ++i)
+    {
+        auto &stats = snapshot.stages[i];
+        stats = stageInfo[i];
+        stats.meanMicroseconds = totalNanoseconds[i] / numBlocks * 1.0e-3;
+        stats.maxMicroseconds = maxNanoseconds[i] * 1.0e-3;
+
+        juce::uint32 count = 0;
+        for (int bucket = 0; bucket < numBuckets; ++bucket)
+        {
+            count += histograms[i][(size_t)bucket];
+            if (count >= p99Rank)
+            {
+                stats.p99Microseconds = juce::jmin(getBucketUpperBound(bucket) * 1.0e-3, stats.maxMicroseconds);
+                break;
+            }
+        }
+    }
+
+    backIndex = latestIndex.exchange(backIndex | freshBit, std::memory_order_acq_rel) & ~freshBit;
+}
+
+int StageProfiler::getBucket(double nanoseconds) noexcept
+{
+    if (nanoseconds < 1.0)
+        return 0;
+
+    return juce::jlimit(0, numBuckets - 1, static_cast<int>(std::log2(nanoseconds) * bucketsPerOctave));
+}
+
+double StageProfiler::getBucketUpperBound(int bucket) noexcept
+{
+    return std::exp2(static_cast<double>(bucket + 1) / bucketsPerOctave);
+}
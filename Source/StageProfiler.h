@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    Per-stage CPU accounting for the compiled effect chain, published to other
+    threads as lock-free snapshots.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class EffectChain;
+
+//==============================================================================
+/**
+    The audio thread times every stage of the chain it processes and folds
+    the per-block cost into a log-spaced histogram. Every windowBlocks blocks
+    the mean, 99th percentile and maximum per stage are published through a
+    triple buffer, so the audio thread never waits for a reader and readers
+    always see a complete window. The p99 is resolved to a quarter octave.
+
+    Everything the audio thread touches is allocated up front. Chains with
+    more than maxStages stages only have their first maxStages profiled.
+ */
+class StageProfiler
+{
+public:
+  static constexpr int maxStages = 32;
+  static constexpr int windowBlocks = 256;
+
+  struct StageStats
+  {
+    const char *name = nullptr; // the stage type, or "filterCascade"
+    int numDescribedStages = 0;
+    double meanMicroseconds = 0.0;
+    double p99Microseconds = 0.0;
+    double maxMicroseconds = 0.0;
+  };
+
+  struct Snapshot
+  {
+    juce::uint32 chainId = 0;
+    int numStages = 0;
+    int numBlocks = 0;
+    std::array<StageStats, maxStages> stages;
+  };
+
+  //==============================================================================
+  /** Audio thread. Starts a new window if the chain has changed. */
+  void startBlock(const EffectChain &chain) noexcept;
+  void addStageTicks(int stage, juce::int64 ticks) noexcept;
+  void endBlock() noexcept;
+
+  //==============================================================================
+  /** Any thread. Empty until the first window has completed. */
+  Snapshot getSnapshot() const;
+
+private:
+  //==============================================================================
+  static constexpr int bucketsPerOctave = 4;
+  static constexpr int numBuckets = 96; // up to about 16 ms per stage and block
+
+  void resetWindow() noexcept;
+  void publish() noexcept;
+
+  static int getBucket(double nanoseconds) noexcept;
+  static double getBucketUpperBound(int bucket) noexcept;
+
+  //==============================================================================
+  // Audio thread only
+  juce::uint32 chainId = 0;
+  int numStages = 0;
+  int numBlocks = 0;
+  std::array<StageStats, maxStages> stageInfo;
+  std::array<juce::int64, maxStages> blockTicks{};
+  std::array<double, maxStages> totalNanoseconds{}, maxNanoseconds{};
+  std::array<std::array<juce::uint32, numBuckets>, maxStages> histograms{};
+  int backIndex = 0;
+
+  // Triple buffer: the audio thread owns backIndex, readers own frontIndex
+  // and the shared index names the latest complete snapshot
+  static constexpr int freshBit = 4;
+  std::array<Snapshot, 3> snapshots;
+  mutable std::atomic<int> latestIndex{1};
+  mutable int frontIndex = 2;
+  mutable juce::SpinLock readLock;
+
+  const double nanosecondsPerTick = 1.0e9 / static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+};